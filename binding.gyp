@@ -10,7 +10,7 @@
 		],
 
 		"target_name": "cpuid",
-		"sources": [ "src/cpuid.cc" ],
+		"sources": [ "src/cpuid.cc", "src/timer.cc", "src/msr.cc", "src/thermal.cc", "src/power.cc", "src/turbo.cc", "src/hwp.cc", "src/frequency.cc", "src/telemetry.cc", "src/cputimes.cc", "src/cgroup.cc" ],
 
 		"conditions": [
 			['OS=="linux"', {
@@ -32,16 +32,27 @@
 
 		"sources": [ 
 			"libcpuid/asm-bits.c",
+			"libcpuid/cgroup.c",
+			"libcpuid/cpufreq.c",
+			"libcpuid/cputimes.c",
 			"libcpuid/cpuid_main.c",
+			"libcpuid/hwp.c",
 			"libcpuid/libcpuid_util.c",
+			"libcpuid/rapl.c",
+			"libcpuid/rdmsr.c",
 			"libcpuid/rdtsc.c",
 			"libcpuid/recog_amd.c",
-			"libcpuid/recog_intel.c"
+			"libcpuid/recog_intel.c",
+			"libcpuid/thermal.c",
+			"libcpuid/topology.c",
+			"libcpuid/turbo.c",
+			"libcpuid/xsave.c"
 		],
 
 		"conditions": [
 			['OS=="win"', {
 				'defines': [ 'WIN32', '_LIB' ],
+				'sources': [ 'libcpuid/msrdriver.c' ],
 			
 				'conditions': [
 					['target_arch=="x64"', {
@@ -50,7 +61,10 @@
 				]
 			}],
 			['OS=="linux"', {
-				'defines': ['HAVE_STDINT_H']
+				'defines': ['HAVE_STDINT_H'],
+				'link_settings': {
+					'libraries': ['-lpthread', '-lm']
+				}
 			}]
 		]
 	}]
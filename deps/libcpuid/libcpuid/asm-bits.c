@@ -26,6 +26,10 @@
 
 #include "libcpuid.h"
 #include "asm-bits.h"
+#ifdef COMPILER_MICROSOFT
+#include <immintrin.h>
+#include <intrin.h>
+#endif
 
 int cpuid_exists_by_eflags(void)
 {
@@ -195,6 +199,51 @@ void cpu_rdtsc(uint64_t* result)
 }
 #endif /* INLINE_ASM_SUPPORTED */
 
+void cpu_rdtscp(uint64_t* result)
+{
+#ifdef COMPILER_GCC
+	uint32_t low_part, hi_part;
+	/* RDTSCP, as raw opcode bytes; ECX receives IA32_TSC_AUX */
+	__asm __volatile(
+		"	.byte	0x0f, 0x01, 0xf9\n"
+		:"=a"(low_part), "=d"(hi_part)
+		:
+		:"ecx", "memory"
+	);
+	*result = (uint64_t)low_part + (((uint64_t) hi_part) << 32);
+#else
+#  ifdef COMPILER_MICROSOFT
+	unsigned int aux;
+	*result = __rdtscp(&aux);
+#  else
+#    error "Unsupported compiler"
+#  endif /* COMPILER_MICROSOFT */
+#endif /* COMPILER_GCC */
+}
+
+/* XGETBV raises #UD unless CR4.OSXSAVE is set: check CPUID.1:ECX[27] first.
+ * MSVC has no inline assembly on x64, but the _xgetbv intrinsic works for
+ * both platforms */
+void exec_xgetbv(uint32_t index, uint32_t *regs)
+{
+#ifdef COMPILER_GCC
+	/* the raw opcode, for assemblers which do not know the mnemonic */
+	__asm __volatile(
+		"	.byte	0x0f, 0x01, 0xd0\n"
+		:"=a"(regs[0]), "=d"(regs[1])
+		:"c"(index)
+	);
+#else
+#  ifdef COMPILER_MICROSOFT
+	uint64_t value = _xgetbv(index);
+	regs[0] = (uint32_t) value;
+	regs[1] = (uint32_t) (value >> 32);
+#  else
+#    error "Unsupported compiler"
+#  endif /* COMPILER_MICROSOFT */
+#endif /* COMPILER_GCC */
+}
+
 #ifdef INLINE_ASM_SUPPORTED
 void busy_sse_loop(int cycles)
 {
@@ -48,6 +48,7 @@
 
 int cpuid_exists_by_eflags(void);
 void exec_cpuid(uint32_t *regs);
+void exec_xgetbv(uint32_t index, uint32_t *regs);
 void busy_sse_loop(int cycles);
 
 #endif /* __ASM_BITS_H__ */
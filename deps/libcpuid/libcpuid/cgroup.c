@@ -0,0 +1,532 @@
+/*
+ * Copyright 2026  cpuid-node contributors
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#if defined(__linux__)
+#define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "libcpuid.h"
+#include "libcpuid_util.h"
+#include "rdtsc.h"
+
+#if defined(__linux__)
+#include <sched.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#define CGROUP_PATH_MAX 512
+
+/* Where the hierarchy of a controller is mounted, and the directory of this
+   process's cgroup in it */
+struct cgroup_dir_t {
+	int version;
+	char mount[CGROUP_PATH_MAX];
+	char dir[CGROUP_PATH_MAX];
+};
+
+static int read_line(const char* path, char* line, int size)
+{
+	FILE* f = fopen(path, "rt");
+	int ok;
+	if (!f) return 0;
+	ok = fgets(line, size, f) != NULL;
+	fclose(f);
+	return ok;
+}
+
+static int file_exists(const char* path)
+{
+	return access(path, F_OK) == 0;
+}
+
+static int is_separator(char c)
+{
+	return c == ',' || c == ' ' || c == '\n' || c == 0;
+}
+
+/* Whether a comma or space separated list, such as "rw,cpu,cpuacct" or
+   "cpuset cpu io", has a token */
+static int has_token(const char* list, const char* token)
+{
+	size_t len = strlen(token);
+	const char* p = list;
+	while ((p = strstr(p, token)) != NULL) {
+		if ((p == list || is_separator(p[-1])) && is_separator(p[len]))
+			return 1;
+		p += len;
+	}
+	return 0;
+}
+
+/* The path of this process's cgroup in the v1 hierarchy of a controller, or
+   in the v2 hierarchy if controller is NULL, from /proc/self/cgroup */
+static int self_cgroup_path(const char* proc_root, const char* controller, char* path, int size)
+{
+	char line[CGROUP_PATH_MAX + 128], file[256];
+	char *controllers, *p;
+	FILE* f;
+	int found = 0;
+	
+	snprintf(file, sizeof(file), "%s/self/cgroup", proc_root);
+	if ((f = fopen(file, "rt")) == NULL)
+		return 0;
+	while (!found && fgets(line, sizeof(line), f)) {
+		line[strcspn(line, "\n")] = 0;
+		/* id:controllers:path */
+		if ((controllers = strchr(line, ':')) == NULL || (p = strchr(++controllers, ':')) == NULL)
+			continue;
+		*p++ = 0;
+		if (controller ? has_token(controllers, controller) : controllers[0] == 0) {
+			snprintf(path, size, "%s", p);
+			found = 1;
+		}
+	}
+	fclose(f);
+	return found;
+}
+
+/* Joins a mount point and a cgroup path, less the part of the path above the
+   root of the mount (which a container does not see) */
+static void join_cgroup_dir(struct cgroup_dir_t* cg, const char* mount_root, const char* path)
+{
+	size_t len = strlen(mount_root);
+	if (strcmp(mount_root, "/") == 0)
+		len = 0;
+	else if (strncmp(path, mount_root, len) != 0 || (path[len] != '/' && path[len] != 0))
+		path = "", len = 0;
+	snprintf(cg->dir, sizeof(cg->dir), "%s%s", cg->mount, path + len);
+	/* "/" alone leaves a trailing slash */
+	len = strlen(cg->dir);
+	if (len > 1 && cg->dir[len - 1] == '/')
+		cg->dir[len - 1] = 0;
+}
+
+/* Finds a controller through /proc/self/mountinfo, preferring a v1 mount of
+   it over the v2 hierarchy. The mount points are taken relative to prefix */
+static int find_mounted_cgroup(const char* proc_root, const char* prefix, const char* controller, struct cgroup_dir_t* cg)
+{
+	char line[2048], file[CGROUP_PATH_MAX + 32], path[CGROUP_PATH_MAX];
+	char root[CGROUP_PATH_MAX], mount[CGROUP_PATH_MAX], v2_root[CGROUP_PATH_MAX];
+	char fstype[64], options[1024];
+	char* sep;
+	FILE* f;
+	int have_v2 = 0;
+	
+	snprintf(file, sizeof(file), "%s/self/mountinfo", proc_root);
+	if ((f = fopen(file, "rt")) == NULL)
+		return 0;
+	while (fgets(line, sizeof(line), f)) {
+		/* id parent major:minor root mount-point options [tags] - fstype source super-options */
+		if (sscanf(line, "%*d %*d %*s %511s %511s", root, mount) != 2 || (sep = strstr(line, " - ")) == NULL)
+			continue;
+		if (sscanf(sep + 3, "%63s %*s %1023s", fstype, options) != 2)
+			continue;
+		if (strcmp(fstype, "cgroup") == 0 && has_token(options, controller) &&
+		    self_cgroup_path(proc_root, controller, path, sizeof(path))) {
+			cg->version = 1;
+			snprintf(cg->mount, sizeof(cg->mount), "%s%s", prefix, mount);
+			join_cgroup_dir(cg, root, path);
+			fclose(f);
+			return 1;
+		}
+		if (strcmp(fstype, "cgroup2") == 0 && !have_v2) {
+			have_v2 = 1;
+			snprintf(cg->mount, sizeof(cg->mount), "%s%s", prefix, mount);
+			snprintf(v2_root, sizeof(v2_root), "%s", root);
+		}
+	}
+	fclose(f);
+	if (!have_v2 || !self_cgroup_path(proc_root, NULL, path, sizeof(path)))
+		return 0;
+	cg->version = 2;
+	join_cgroup_dir(cg, v2_root, path);
+	/* A hybrid setup mounts a v2 hierarchy without the controller in it */
+	snprintf(file, sizeof(file), "%s/cgroup.controllers", cg->mount);
+	return read_line(file, line, sizeof(line)) && has_token(line, controller);
+}
+
+/* With an explicit cgroup root (e.g. a test fixture) and no mountinfo, it is
+   the v2 mount if it has a cgroup.controllers file, and holds the v1 mounts
+   otherwise */
+static int find_fixture_cgroup(const char* proc_root, const char* cgroup_root, const char* controller, struct cgroup_dir_t* cg)
+{
+	char path[CGROUP_PATH_MAX], file[CGROUP_PATH_MAX + 32];
+	
+	snprintf(file, sizeof(file), "%s/cgroup.controllers", cgroup_root);
+	if (file_exists(file)) {
+		cg->version = 2;
+		snprintf(cg->mount, sizeof(cg->mount), "%s", cgroup_root);
+		if (!self_cgroup_path(proc_root, NULL, path, sizeof(path)))
+			snprintf(path, sizeof(path), "/");
+	} else {
+		cg->version = 1;
+		snprintf(cg->mount, sizeof(cg->mount), "%s/%s", cgroup_root, controller);
+		if (strcmp(controller, "cpu") == 0 && !file_exists(cg->mount))
+			snprintf(cg->mount, sizeof(cg->mount), "%s/cpu,cpuacct", cgroup_root);
+		if (!file_exists(cg->mount))
+			return 0;
+		if (!self_cgroup_path(proc_root, controller, path, sizeof(path)))
+			snprintf(path, sizeof(path), "/");
+	}
+	join_cgroup_dir(cg, "/", path);
+	return 1;
+}
+
+static int find_cgroup(const char* proc_root, const char* cgroup_root, const char* controller, struct cgroup_dir_t* cg)
+{
+	char file[CGROUP_PATH_MAX];
+	
+	memset(cg, 0, sizeof(*cg));
+	if (!proc_root)
+		proc_root = "/proc";
+	if (!cgroup_root)
+		return find_mounted_cgroup(proc_root, "", controller, cg);
+	/* A fixture with a mountinfo has the mount points under cgroup_root */
+	snprintf(file, sizeof(file), "%s/self/mountinfo", proc_root);
+	if (file_exists(file))
+		return find_mounted_cgroup(proc_root, cgroup_root, controller, cg);
+	return find_fixture_cgroup(proc_root, cgroup_root, controller, cg);
+}
+
+/* Goes one directory up, unless dir is the mount point already */
+static int parent_cgroup(const struct cgroup_dir_t* cg, char* dir)
+{
+	char* slash;
+	if (strcmp(dir, cg->mount) == 0 || strlen(dir) <= strlen(cg->mount))
+		return 0;
+	if ((slash = strrchr(dir, '/')) == NULL)
+		return 0;
+	*slash = 0;
+	return 1;
+}
+
+/* The tightest CFS quota of the cgroup and its ancestors, which all apply */
+static void read_cpu_quota(const struct cgroup_dir_t* cg, struct cpu_effective_t* eff)
+{
+	char dir[CGROUP_PATH_MAX], file[CGROUP_PATH_MAX + 32], line[128], max[32];
+	long quota, period;
+	
+	snprintf(dir, sizeof(dir), "%s", cg->dir);
+	do {
+		quota = period = -1;
+		if (cg->version == 2) {
+			/* "max 100000", or "<quota> <period>" */
+			snprintf(file, sizeof(file), "%s/cpu.max", dir);
+			if (read_line(file, line, sizeof(line)) && sscanf(line, "%31s %ld", max, &period) == 2 &&
+			    strcmp(max, "max") != 0)
+				quota = strtol(max, NULL, 10);
+		} else {
+			snprintf(file, sizeof(file), "%s/cpu.cfs_quota_us", dir);
+			if (read_line(file, line, sizeof(line)))
+				quota = strtol(line, NULL, 10);
+			snprintf(file, sizeof(file), "%s/cpu.cfs_period_us", dir);
+			if (read_line(file, line, sizeof(line)))
+				period = strtol(line, NULL, 10);
+		}
+		if (quota > 0 && period > 0 && (eff->quota < 0 || (double) quota / period < eff->quota)) {
+			eff->quota = (double) quota / period;
+			eff->quota_us = quota;
+			eff->period_us = period;
+		}
+	} while (parent_cgroup(cg, dir));
+}
+
+static void mark_cpu(int cpu, void* arg)
+{
+	unsigned char* allowed = (unsigned char*) arg;
+	if (cpu >= 0 && cpu < MAX_EFFECTIVE_CPUS)
+		allowed[cpu] = 1;
+}
+
+/* The CPUs of the cpuset, or 0 if it has no list (an empty v2
+   cpuset.cpus means the parent's) */
+static int read_cpuset(const struct cgroup_dir_t* cg, unsigned char* allowed)
+{
+	const char* v2_files[] = { "cpuset.cpus.effective", "cpuset.cpus" };
+	const char* v1_files[] = { "cpuset.effective_cpus", "cpuset.cpus" };
+	const char** files = cg->version == 2 ? v2_files : v1_files;
+	char dir[CGROUP_PATH_MAX], file[CGROUP_PATH_MAX + 32], line[4096];
+	int i;
+	
+	snprintf(dir, sizeof(dir), "%s", cg->dir);
+	do {
+		for (i = 0; i < 2; i++) {
+			snprintf(file, sizeof(file), "%s/%s", dir, files[i]);
+			if (read_line(file, line, sizeof(line)) && line[0] >= '0' && line[0] <= '9')
+				return parse_cpu_list(line, mark_cpu, allowed);
+		}
+	} while (parent_cgroup(cg, dir));
+	return 0;
+}
+
+int cpu_effective_cpus(const char* proc_root, const char* cgroup_root, struct cpu_effective_t* eff)
+{
+	struct cgroup_dir_t cg;
+	unsigned char allowed[MAX_EFFECTIVE_CPUS], cpuset[MAX_EFFECTIVE_CPUS];
+	cpu_set_t affinity;
+	int cpu, limited = 0;
+	
+	if (!eff)
+		return set_error(ERR_HANDLE);
+	memset(eff, 0, sizeof(struct cpu_effective_t));
+	eff->quota = -1;
+	eff->quota_us = eff->period_us = -1;
+	eff->online_cpus = (int) sysconf(_SC_NPROCESSORS_ONLN);
+	
+	/* A fixture describes the whole state; the affinity of this process
+	   has nothing to do with it */
+	memset(allowed, 0, sizeof(allowed));
+	CPU_ZERO(&affinity);
+	if (cgroup_root || sched_getaffinity(0, sizeof(affinity), &affinity)) {
+		memset(allowed, 1, sizeof(allowed));
+	} else {
+		for (cpu = 0; cpu < MAX_EFFECTIVE_CPUS && cpu < CPU_SETSIZE; cpu++)
+			allowed[cpu] = CPU_ISSET(cpu, &affinity) ? 1 : 0;
+		limited = 1;
+	}
+	
+	if (find_cgroup(proc_root, cgroup_root, "cpuset", &cg)) {
+		eff->cgroup_version = cg.version;
+		memset(cpuset, 0, sizeof(cpuset));
+		if (read_cpuset(&cg, cpuset) > 0) {
+			for (cpu = 0; cpu < MAX_EFFECTIVE_CPUS; cpu++)
+				allowed[cpu] &= cpuset[cpu];
+			limited = 1;
+		}
+	}
+	if (find_cgroup(proc_root, cgroup_root, "cpu", &cg)) {
+		eff->cgroup_version = cg.version;
+		read_cpu_quota(&cg, eff);
+	}
+	
+	if (limited) {
+		for (cpu = 0; cpu < MAX_EFFECTIVE_CPUS; cpu++)
+			if (allowed[cpu])
+				eff->cpus[eff->num_cpus++] = cpu;
+	} else {
+		for (cpu = 0; cpu < eff->online_cpus && cpu < MAX_EFFECTIVE_CPUS; cpu++)
+			eff->cpus[eff->num_cpus++] = cpu;
+	}
+	
+	eff->parallelism = eff->num_cpus > 0 ? eff->num_cpus : 1;
+	if (eff->quota > 0 && eff->quota < eff->parallelism) {
+		/* Round up: a 1.5 CPU quota keeps two threads busy 75% of the time */
+		eff->parallelism = (int) eff->quota;
+		if (eff->parallelism < eff->quota)
+			eff->parallelism++;
+	}
+	return set_error(ERR_OK);
+}
+
+#define EFFECTIVE_CPUS_DEFINED
+
+struct cpu_pressure_reader_t {
+	int version;
+	int stat_fd;
+	int pressure_fd;
+};
+
+static int open_attribute(const char* dir, const char* name)
+{
+	char path[CGROUP_PATH_MAX + 32];
+	snprintf(path, sizeof(path), "%s/%s", dir, name);
+	return open(path, O_RDONLY | O_CLOEXEC);
+}
+
+struct cpu_pressure_reader_t* cpu_pressure_open(const char* proc_root, const char* cgroup_root)
+{
+	struct cpu_pressure_reader_t* reader;
+	struct cgroup_dir_t cg;
+	char path[CGROUP_PATH_MAX];
+	
+	reader = (struct cpu_pressure_reader_t*) calloc(1, sizeof(struct cpu_pressure_reader_t));
+	if (!reader) {
+		set_error(ERR_NO_MEM);
+		return NULL;
+	}
+	reader->stat_fd = reader->pressure_fd = -1;
+	if (find_cgroup(proc_root, cgroup_root, "cpu", &cg)) {
+		reader->version = cg.version;
+		reader->stat_fd = open_attribute(cg.dir, "cpu.stat");
+		/* Only cgroup v2 accounts pressure per cgroup */
+		if (cg.version == 2)
+			reader->pressure_fd = open_attribute(cg.dir, "cpu.pressure");
+	}
+	if (reader->pressure_fd < 0) {
+		snprintf(path, sizeof(path), "%s/pressure", proc_root ? proc_root : "/proc");
+		reader->pressure_fd = open_attribute(path, "cpu");
+	}
+	if (reader->stat_fd < 0 && reader->pressure_fd < 0) {
+		free(reader);
+		set_error(ERR_NOT_IMP);
+		return NULL;
+	}
+	set_error(ERR_OK);
+	return reader;
+}
+
+static int pread_text(int fd, char* buf, int size)
+{
+	ssize_t len;
+	if (fd < 0)
+		return 0;
+	len = pread(fd, buf, size - 1, 0);
+	if (len <= 0)
+		return 0;
+	buf[len] = 0;
+	return 1;
+}
+
+/* "some avg10=1.53 avg60=0.87 avg300=0.35 total=1234567" */
+static void parse_pressure_line(const char* line, double* avg10, double* avg60, double* avg300, int64_t* total_us)
+{
+	long long total;
+	if (sscanf(line, "%*s avg10=%lf avg60=%lf avg300=%lf total=%lld", avg10, avg60, avg300, &total) == 4)
+		*total_us = total;
+}
+
+int cpu_pressure_read(struct cpu_pressure_reader_t* reader, struct cpu_pressure_t* pressure)
+{
+	char buf[1024], key[64];
+	char *line, *save;
+	long long value;
+	uint64_t now;
+	
+	if (!reader || !pressure)
+		return set_error(ERR_HANDLE);
+	sys_monotonic_clock_ns(&now);
+	pressure->timestamp_us = now / 1000;
+	pressure->usage_us = pressure->nr_periods = pressure->nr_throttled = pressure->throttled_us = -1;
+	pressure->some_avg10 = pressure->some_avg60 = pressure->some_avg300 = -1;
+	pressure->full_avg10 = pressure->full_avg60 = pressure->full_avg300 = -1;
+	pressure->some_total_us = pressure->full_total_us = -1;
+	
+	if (pread_text(reader->stat_fd, buf, sizeof(buf))) {
+		for (line = strtok_r(buf, "\n", &save); line; line = strtok_r(NULL, "\n", &save)) {
+			if (sscanf(line, "%63s %lld", key, &value) != 2)
+				continue;
+			if (strcmp(key, "usage_usec") == 0)
+				pressure->usage_us = value;
+			else if (strcmp(key, "nr_periods") == 0)
+				pressure->nr_periods = value;
+			else if (strcmp(key, "nr_throttled") == 0)
+				pressure->nr_throttled = value;
+			else if (strcmp(key, "throttled_usec") == 0)
+				pressure->throttled_us = value;
+			else if (strcmp(key, "throttled_time") == 0)
+				pressure->throttled_us = value / 1000; /* v1 counts nanoseconds */
+		}
+	}
+	if (pread_text(reader->pressure_fd, buf, sizeof(buf))) {
+		for (line = strtok_r(buf, "\n", &save); line; line = strtok_r(NULL, "\n", &save)) {
+			if (strncmp(line, "some ", 5) == 0)
+				parse_pressure_line(line, &pressure->some_avg10, &pressure->some_avg60, &pressure->some_avg300, &pressure->some_total_us);
+			else if (strncmp(line, "full ", 5) == 0)
+				parse_pressure_line(line, &pressure->full_avg10, &pressure->full_avg60, &pressure->full_avg300, &pressure->full_total_us);
+		}
+	}
+	return set_error(ERR_OK);
+}
+
+void cpu_pressure_close(struct cpu_pressure_reader_t* reader)
+{
+	if (!reader) return;
+	if (reader->stat_fd >= 0)
+		close(reader->stat_fd);
+	if (reader->pressure_fd >= 0)
+		close(reader->pressure_fd);
+	free(reader);
+}
+
+#define CPU_PRESSURE_DEFINED
+#endif /* __linux__ */
+
+#ifndef EFFECTIVE_CPUS_DEFINED
+int cpu_effective_cpus(const char* proc_root, const char* cgroup_root, struct cpu_effective_t* eff)
+{
+	struct cpu_id_t* id = get_cached_cpuid();
+	int cpu;
+	
+	if (!eff)
+		return set_error(ERR_HANDLE);
+	memset(eff, 0, sizeof(struct cpu_effective_t));
+	eff->quota = -1;
+	eff->quota_us = eff->period_us = -1;
+	eff->online_cpus = id && id->total_logical_cpus > 0 ? id->total_logical_cpus : 1;
+	for (cpu = 0; cpu < eff->online_cpus && cpu < MAX_EFFECTIVE_CPUS; cpu++)
+		eff->cpus[eff->num_cpus++] = cpu;
+	eff->parallelism = eff->num_cpus;
+	return set_error(ERR_OK);
+}
+#endif /* EFFECTIVE_CPUS_DEFINED */
+
+#ifndef CPU_PRESSURE_DEFINED
+struct cpu_pressure_reader_t* cpu_pressure_open(const char* proc_root, const char* cgroup_root)
+{
+	set_error(ERR_NOT_IMP);
+	return NULL;
+}
+
+int cpu_pressure_read(struct cpu_pressure_reader_t* reader, struct cpu_pressure_t* pressure)
+{
+	return set_error(ERR_NOT_IMP);
+}
+
+void cpu_pressure_close(struct cpu_pressure_reader_t* reader)
+{
+}
+#endif /* CPU_PRESSURE_DEFINED */
+
+/* The growth of a counter, or -1 if either reading lacks it or it went
+   backwards (the cgroup was recreated) */
+static double counter_growth(int64_t before, int64_t after)
+{
+	if (before < 0 || after < 0 || after < before)
+		return -1;
+	return (double) (after - before);
+}
+
+static double per_window(double growth, double whole)
+{
+	return growth >= 0 && whole > 0 ? growth / whole : -1;
+}
+
+int cpu_pressure_rates(const struct cpu_pressure_t* before, const struct cpu_pressure_t* after, struct cpu_pressure_rates_t* rates)
+{
+	double elapsed_us;
+	
+	if (!before || !after || !rates)
+		return set_error(ERR_HANDLE);
+	elapsed_us = after->timestamp_us > before->timestamp_us ? (double) (after->timestamp_us - before->timestamp_us) : 0;
+	rates->seconds = elapsed_us / 1e6;
+	rates->usage = per_window(counter_growth(before->usage_us, after->usage_us), elapsed_us);
+	rates->throttled = per_window(counter_growth(before->throttled_us, after->throttled_us), elapsed_us);
+	rates->throttled_periods = per_window(counter_growth(before->nr_throttled, after->nr_throttled),
+	                                      counter_growth(before->nr_periods, after->nr_periods));
+	rates->some = per_window(counter_growth(before->some_total_us, after->some_total_us), elapsed_us);
+	rates->full = per_window(counter_growth(before->full_total_us, after->full_total_us), elapsed_us);
+	return set_error(elapsed_us > 0 ? ERR_OK : ERR_HANDLE);
+}
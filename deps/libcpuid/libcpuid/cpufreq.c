@@ -0,0 +1,173 @@
+/*
+ * Copyright 2026  cpuid-node contributors
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "libcpuid.h"
+#include "libcpuid_util.h"
+
+#if defined(__linux__)
+#include <unistd.h>
+#include <fcntl.h>
+
+struct cpu_freq_sampler_t {
+	int count;
+	int* cpus;
+	int* fds;
+	const char* sysfs_root;
+};
+
+static void open_cur_freq(int cpu, void* arg)
+{
+	struct cpu_freq_sampler_t* sampler = (struct cpu_freq_sampler_t*) arg;
+	char path[256];
+	int fd;
+	
+	snprintf(path, sizeof(path), "%s/devices/system/cpu/cpu%d/cpufreq/scaling_cur_freq", sampler->sysfs_root, cpu);
+	if ((fd = open(path, O_RDONLY | O_CLOEXEC)) < 0)
+		return;
+	sampler->cpus[sampler->count] = cpu;
+	sampler->fds[sampler->count++] = fd;
+}
+
+static void count_listed_cpu(int cpu, void* arg)
+{
+	(void) cpu;
+	(*(int*) arg)++;
+}
+
+struct cpu_freq_sampler_t* cpu_freq_sampler_create(const char* sysfs_root)
+{
+	struct cpu_freq_sampler_t* sampler;
+	char path[256], online[4096];
+	FILE* f;
+	int listed = 0;
+	
+	if (!sysfs_root)
+		sysfs_root = "/sys";
+	online[0] = 0;
+	snprintf(path, sizeof(path), "%s/devices/system/cpu/online", sysfs_root);
+	if ((f = fopen(path, "rt")) != NULL) {
+		if (!fgets(online, sizeof(online), f))
+			online[0] = 0;
+		fclose(f);
+	}
+	if (!online[0])
+		snprintf(online, sizeof(online), "0-%ld", sysconf(_SC_NPROCESSORS_CONF) - 1);
+	parse_cpu_list(online, count_listed_cpu, &listed);
+	
+	sampler = (struct cpu_freq_sampler_t*) calloc(1, sizeof(struct cpu_freq_sampler_t));
+	if (sampler) {
+		sampler->cpus = (int*) calloc(listed > 0 ? listed : 1, sizeof(int));
+		sampler->fds = (int*) calloc(listed > 0 ? listed : 1, sizeof(int));
+	}
+	if (!sampler || !sampler->cpus || !sampler->fds) {
+		cpu_freq_sampler_destroy(sampler);
+		set_error(ERR_NO_MEM);
+		return NULL;
+	}
+	sampler->sysfs_root = sysfs_root;
+	parse_cpu_list(online, open_cur_freq, sampler);
+	sampler->sysfs_root = NULL;
+	if (sampler->count == 0) {
+		cpu_freq_sampler_destroy(sampler);
+		set_error(ERR_NOT_IMP);
+		return NULL;
+	}
+	set_error(ERR_OK);
+	return sampler;
+}
+
+int cpu_freq_sample(struct cpu_freq_sampler_t* sampler, double* mhz, int max_cpus)
+{
+	char buf[32];
+	ssize_t len;
+	long khz;
+	int i;
+	
+	if (!sampler || !mhz)
+		return set_error(ERR_HANDLE);
+	for (i = 0; i < sampler->count && i < max_cpus; i++) {
+		/* sysfs regenerates the attribute on every read from offset 0 */
+		len = pread(sampler->fds[i], buf, sizeof(buf) - 1, 0);
+		if (len <= 0) {
+			mhz[i] = -1;
+			continue;
+		}
+		buf[len] = 0;
+		khz = strtol(buf, NULL, 10);
+		mhz[i] = khz > 0 ? khz / 1000.0 : -1;
+	}
+	set_error(ERR_OK);
+	return i;
+}
+
+void cpu_freq_sampler_destroy(struct cpu_freq_sampler_t* sampler)
+{
+	int i;
+	if (!sampler) return;
+	for (i = 0; i < sampler->count; i++)
+		close(sampler->fds[i]);
+	free(sampler->fds);
+	free(sampler->cpus);
+	free(sampler);
+}
+
+#define CPU_FREQ_SAMPLER_DEFINED
+#endif /* __linux__ */
+
+#ifndef CPU_FREQ_SAMPLER_DEFINED
+struct cpu_freq_sampler_t {
+	int count;
+	int* cpus;
+};
+
+struct cpu_freq_sampler_t* cpu_freq_sampler_create(const char* sysfs_root)
+{
+	set_error(ERR_NOT_IMP);
+	return NULL;
+}
+
+int cpu_freq_sample(struct cpu_freq_sampler_t* sampler, double* mhz, int max_cpus)
+{
+	return set_error(ERR_NOT_IMP);
+}
+
+void cpu_freq_sampler_destroy(struct cpu_freq_sampler_t* sampler)
+{
+}
+#endif /* CPU_FREQ_SAMPLER_DEFINED */
+
+int cpu_freq_sampler_count(struct cpu_freq_sampler_t* sampler)
+{
+	return sampler ? sampler->count : 0;
+}
+
+int cpu_freq_sampler_cpu(struct cpu_freq_sampler_t* sampler, int index)
+{
+	if (!sampler || index < 0 || index >= sampler->count)
+		return -1;
+	return sampler->cpus[index];
+}
@@ -23,6 +23,9 @@
  * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
  * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
+#if defined linux || defined __linux__
+#define _GNU_SOURCE
+#endif
 #include "libcpuid.h"
 #include "recog_intel.h"
 #include "recog_amd.h"
@@ -37,7 +40,17 @@
 
 /* Implementation: */
 
-static int _libcpiud_errno = ERR_OK;
+/* The error code is per thread, so that concurrent callers (e.g. several
+   Node.js worker threads) each see the result of their own call */
+#if defined(_MSC_VER)
+#	define LIBCPUID_THREAD_LOCAL __declspec(thread)
+#elif defined(__GNUC__)
+#	define LIBCPUID_THREAD_LOCAL __thread
+#else
+#	define LIBCPUID_THREAD_LOCAL
+#endif
+
+static LIBCPUID_THREAD_LOCAL int _libcpiud_errno = ERR_OK;
 
 int set_error(cpu_error_t err)
 {
@@ -45,6 +58,11 @@ int set_error(cpu_error_t err)
 	return (int) err;
 }
 
+int get_error(void)
+{
+	return _libcpiud_errno;
+}
+
 static void raw_data_t_constructor(struct cpu_raw_data_t* raw)
 {
 	memset(raw, 0, sizeof(struct cpu_raw_data_t));
@@ -138,6 +156,136 @@ static int get_total_cpus(void)
 }
 #endif /* GET_TOTAL_CPUS_DEFINED */
 
+/* Per-CPU probing: get_all_raw_data() system specific code pins one thread to
+   each logical CPU the process may run on and reads the raw CPUID data there.
+   All threads run concurrently, so the sweep takes about as long as a single
+   probe. */
+static void raw_data_fill(struct cpu_raw_data_t* data);
+static uint32_t raw_data_apic_id(const struct cpu_raw_data_t* data);
+
+#if defined linux || defined __linux__
+#include <pthread.h>
+#include <sched.h>
+
+static void* raw_probe_thread(void* arg)
+{
+	struct cpu_logical_raw_t* cpu = (struct cpu_logical_raw_t*) arg;
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu->os_cpu, &set);
+	if (sched_setaffinity(0, sizeof(set), &set)) {
+		cpu->os_cpu = -1;
+		return NULL;
+	}
+	raw_data_fill(&cpu->raw);
+	cpu->apic_id = raw_data_apic_id(&cpu->raw);
+	return NULL;
+}
+
+static int get_all_raw_data(struct cpu_raw_data_array_t* data)
+{
+	cpu_set_t allowed;
+	pthread_t* threads;
+	uint8_t* started;
+	int i, n = 0;
+	
+	CPU_ZERO(&allowed);
+	if (sched_getaffinity(0, sizeof(allowed), &allowed))
+		return ERR_NOT_IMP;
+	data->cpus = (struct cpu_logical_raw_t*) calloc(CPU_COUNT(&allowed), sizeof(struct cpu_logical_raw_t));
+	threads = (pthread_t*) malloc(CPU_COUNT(&allowed) * sizeof(pthread_t));
+	started = (uint8_t*) calloc(CPU_COUNT(&allowed), 1);
+	if (!data->cpus || !threads || !started) {
+		free(data->cpus);
+		free(threads);
+		free(started);
+		data->cpus = NULL;
+		return ERR_NO_MEM;
+	}
+	for (i = 0; i < CPU_SETSIZE; i++)
+		if (CPU_ISSET(i, &allowed))
+			data->cpus[n++].os_cpu = i;
+	data->num_raw = n;
+	for (i = 0; i < n; i++)
+		started[i] = !pthread_create(&threads[i], NULL, raw_probe_thread, &data->cpus[i]);
+	for (i = 0; i < n; i++) {
+		if (started[i])
+			pthread_join(threads[i], NULL);
+		else
+			data->cpus[i].os_cpu = -1;
+	}
+	free(threads);
+	free(started);
+	return ERR_OK;
+}
+#define GET_ALL_RAW_DATA_DEFINED
+#endif
+
+#ifdef _WIN32
+static DWORD WINAPI raw_probe_thread(LPVOID arg)
+{
+	struct cpu_logical_raw_t* cpu = (struct cpu_logical_raw_t*) arg;
+	if (!SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR) 1 << cpu->os_cpu)) {
+		cpu->os_cpu = -1;
+		return 0;
+	}
+	raw_data_fill(&cpu->raw);
+	cpu->apic_id = raw_data_apic_id(&cpu->raw);
+	return 0;
+}
+
+static int get_all_raw_data(struct cpu_raw_data_array_t* data)
+{
+	DWORD_PTR process_mask, system_mask;
+	HANDLE* threads;
+	int i, n = 0, total = 0;
+	
+	if (!GetProcessAffinityMask(GetCurrentProcess(), &process_mask, &system_mask))
+		return ERR_NOT_IMP;
+	for (i = 0; i < (int) (sizeof(DWORD_PTR) * 8); i++)
+		if (process_mask & ((DWORD_PTR) 1 << i)) total++;
+	data->cpus = (struct cpu_logical_raw_t*) calloc(total, sizeof(struct cpu_logical_raw_t));
+	threads = (HANDLE*) calloc(total, sizeof(HANDLE));
+	if (!data->cpus || !threads) {
+		free(data->cpus);
+		free(threads);
+		data->cpus = NULL;
+		return ERR_NO_MEM;
+	}
+	for (i = 0; i < (int) (sizeof(DWORD_PTR) * 8); i++)
+		if (process_mask & ((DWORD_PTR) 1 << i))
+			data->cpus[n++].os_cpu = i;
+	data->num_raw = n;
+	for (i = 0; i < n; i++)
+		threads[i] = CreateThread(NULL, 0, raw_probe_thread, &data->cpus[i], 0, NULL);
+	for (i = 0; i < n; i++) {
+		if (threads[i]) {
+			WaitForSingleObject(threads[i], INFINITE);
+			CloseHandle(threads[i]);
+		} else {
+			data->cpus[i].os_cpu = -1;
+		}
+	}
+	free(threads);
+	return ERR_OK;
+}
+#define GET_ALL_RAW_DATA_DEFINED
+#endif
+
+#ifndef GET_ALL_RAW_DATA_DEFINED
+static int get_all_raw_data(struct cpu_raw_data_array_t* data)
+{
+	/* No way to pin threads here: report the CPU we happen to run on */
+	data->cpus = (struct cpu_logical_raw_t*) calloc(1, sizeof(struct cpu_logical_raw_t));
+	if (!data->cpus)
+		return ERR_NO_MEM;
+	data->num_raw = 1;
+	data->cpus[0].os_cpu = 0;
+	raw_data_fill(&data->cpus[0].raw);
+	data->cpus[0].apic_id = raw_data_apic_id(&data->cpus[0].raw);
+	return ERR_OK;
+}
+#endif /* GET_ALL_RAW_DATA_DEFINED */
 
 static void load_features_common(struct cpu_raw_data_t* raw, struct cpu_id_t* data)
 {
@@ -170,6 +318,7 @@ static void load_features_common(struct cpu_raw_data_t* raw, struct cpu_id_t* da
 		{  0, CPU_FEATURE_PNI },
 		{  3, CPU_FEATURE_MONITOR },
 		{  9, CPU_FEATURE_SSSE3 },
+		{ 12, CPU_FEATURE_FMA3 },
 		{ 13, CPU_FEATURE_CX16 },
 		{ 19, CPU_FEATURE_SSE4_1 },
 		{ 23, CPU_FEATURE_POPCNT },
@@ -182,6 +331,78 @@ static void load_features_common(struct cpu_raw_data_t* raw, struct cpu_id_t* da
 	const struct feature_map_t matchtable_ecx81[] = {
 		{  0, CPU_FEATURE_LAHF_LM },
 	};
+	const struct feature_map_t matchtable_ebx7[] = {
+		{  0, CPU_FEATURE_FSGSBASE },
+		{  3, CPU_FEATURE_BMI1 },
+		{  4, CPU_FEATURE_HLE },
+		{  5, CPU_FEATURE_AVX2 },
+		{  7, CPU_FEATURE_SMEP },
+		{  8, CPU_FEATURE_BMI2 },
+		{  9, CPU_FEATURE_ERMS },
+		{ 10, CPU_FEATURE_INVPCID },
+		{ 11, CPU_FEATURE_RTM },
+		{ 16, CPU_FEATURE_AVX512F },
+		{ 17, CPU_FEATURE_AVX512DQ },
+		{ 18, CPU_FEATURE_RDSEED },
+		{ 19, CPU_FEATURE_ADX },
+		{ 20, CPU_FEATURE_SMAP },
+		{ 21, CPU_FEATURE_AVX512IFMA },
+		{ 23, CPU_FEATURE_CLFLUSHOPT },
+		{ 24, CPU_FEATURE_CLWB },
+		{ 26, CPU_FEATURE_AVX512PF },
+		{ 27, CPU_FEATURE_AVX512ER },
+		{ 28, CPU_FEATURE_AVX512CD },
+		{ 29, CPU_FEATURE_SHA_NI },
+		{ 30, CPU_FEATURE_AVX512BW },
+		{ 31, CPU_FEATURE_AVX512VL },
+	};
+	const struct feature_map_t matchtable_ecx7[] = {
+		{  1, CPU_FEATURE_AVX512VBMI },
+		{  2, CPU_FEATURE_UMIP },
+		{  3, CPU_FEATURE_PKU },
+		{  5, CPU_FEATURE_WAITPKG },
+		{  6, CPU_FEATURE_AVX512VBMI2 },
+		{  8, CPU_FEATURE_GFNI },
+		{  9, CPU_FEATURE_VAES },
+		{ 10, CPU_FEATURE_VPCLMULQDQ },
+		{ 11, CPU_FEATURE_AVX512VNNI },
+		{ 12, CPU_FEATURE_AVX512BITALG },
+		{ 14, CPU_FEATURE_AVX512VPOPCNTDQ },
+		{ 22, CPU_FEATURE_RDPID },
+		{ 27, CPU_FEATURE_MOVDIRI },
+		{ 28, CPU_FEATURE_MOVDIR64B },
+	};
+	const struct feature_map_t matchtable_edx7[] = {
+		{  4, CPU_FEATURE_FSRM },
+		{  8, CPU_FEATURE_AVX512VP2INTERSECT },
+		{ 10, CPU_FEATURE_MD_CLEAR },
+		{ 14, CPU_FEATURE_SERIALIZE },
+		{ 15, CPU_FEATURE_HYBRID },
+		{ 22, CPU_FEATURE_AMX_BF16 },
+		{ 23, CPU_FEATURE_AVX512FP16 },
+		{ 24, CPU_FEATURE_AMX_TILE },
+		{ 25, CPU_FEATURE_AMX_INT8 },
+	};
+	const struct feature_map_t matchtable_eax7_1[] = {
+		{  4, CPU_FEATURE_AVX_VNNI },
+		{  5, CPU_FEATURE_AVX512BF16 },
+		{ 10, CPU_FEATURE_FZLRM },
+		{ 11, CPU_FEATURE_FSRS },
+		{ 12, CPU_FEATURE_FSRCS },
+		{ 21, CPU_FEATURE_AMX_FP16 },
+		{ 23, CPU_FEATURE_AVX_IFMA },
+	};
+	const struct feature_map_t matchtable_edx7_1[] = {
+		{  4, CPU_FEATURE_AVX_VNNI_INT8 },
+		{  5, CPU_FEATURE_AVX_NE_CONVERT },
+		{ 19, CPU_FEATURE_AVX10 },
+	};
+	const struct feature_map_t matchtable_edx7_2[] = {
+		{  0, CPU_FEATURE_PSFD },
+		{  1, CPU_FEATURE_IPRED_CTRL },
+		{  2, CPU_FEATURE_RRSBA_CTRL },
+		{  4, CPU_FEATURE_BHI_CTRL },
+	};
 	if (raw->basic_cpuid[0][0] >= 1) {
 		match_features(matchtable_edx1, COUNT_OF(matchtable_edx1), raw->basic_cpuid[1][3], data);
 		match_features(matchtable_ecx1, COUNT_OF(matchtable_ecx1), raw->basic_cpuid[1][2], data);
@@ -190,6 +411,21 @@ static void load_features_common(struct cpu_raw_data_t* raw, struct cpu_id_t* da
 		match_features(matchtable_edx81, COUNT_OF(matchtable_edx81), raw->ext_cpuid[1][3], data);
 		match_features(matchtable_ecx81, COUNT_OF(matchtable_ecx81), raw->ext_cpuid[1][2], data);
 	}
+	/* The invariant TSC bit is architectural on both Intel and AMD */
+	if (raw->ext_cpuid[0][0] >= 0x80000007 && (raw->ext_cpuid[7][3] & (1 << 8)))
+		data->flags[CPU_FEATURE_CONSTANT_TSC] = 1;
+	if (raw->basic_cpuid[0][0] >= 7) {
+		/* leaf 7 subleaf 0 EAX holds the highest valid subleaf */
+		match_features(matchtable_ebx7, COUNT_OF(matchtable_ebx7), raw->intel_fn7[0][1], data);
+		match_features(matchtable_ecx7, COUNT_OF(matchtable_ecx7), raw->intel_fn7[0][2], data);
+		match_features(matchtable_edx7, COUNT_OF(matchtable_edx7), raw->intel_fn7[0][3], data);
+		if (raw->intel_fn7[0][0] >= 1) {
+			match_features(matchtable_eax7_1, COUNT_OF(matchtable_eax7_1), raw->intel_fn7[1][0], data);
+			match_features(matchtable_edx7_1, COUNT_OF(matchtable_edx7_1), raw->intel_fn7[1][3], data);
+		}
+		if (raw->intel_fn7[0][0] >= 2)
+			match_features(matchtable_edx7_2, COUNT_OF(matchtable_edx7_2), raw->intel_fn7[2][3], data);
+	}
 	if (data->flags[CPU_FEATURE_SSE]) {
 		/* apply guesswork to check if the SSE unit width is 128 bit */
 		switch (data->vendor) {
@@ -311,30 +547,97 @@ void cpu_exec_cpuid_ext(uint32_t* regs)
 	exec_cpuid(regs);
 }
 
-int cpuid_get_raw_data(struct cpu_raw_data_t* data)
+static void raw_data_fill(struct cpu_raw_data_t* data)
 {
 	unsigned i;
-	if (!cpuid_present())
-		return set_error(ERR_NO_CPUID);
 	for (i = 0; i < 32; i++)
 		cpu_exec_cpuid(i, data->basic_cpuid[i]);
 	for (i = 0; i < 32; i++)
 		cpu_exec_cpuid(0x80000000 + i, data->ext_cpuid[i]);
-	for (i = 0; i < 4; i++) {
+	for (i = 0; i < MAX_INTELFN4_LEVEL; i++) {
 		memset(data->intel_fn4[i], 0, sizeof(data->intel_fn4[i]));
 		data->intel_fn4[i][0] = 4;
 		data->intel_fn4[i][2] = i;
 		cpu_exec_cpuid_ext(data->intel_fn4[i]);
 	}
+	for (i = 0; i < MAX_INTELFN7_LEVEL; i++) {
+		memset(data->intel_fn7[i], 0, sizeof(data->intel_fn7[i]));
+		data->intel_fn7[i][0] = 7;
+		data->intel_fn7[i][2] = i;
+		cpu_exec_cpuid_ext(data->intel_fn7[i]);
+	}
+	for (i = 0; i < MAX_INTELFN13_LEVEL; i++) {
+		memset(data->intel_fn13[i], 0, sizeof(data->intel_fn13[i]));
+		data->intel_fn13[i][0] = 13;
+		data->intel_fn13[i][2] = i;
+		cpu_exec_cpuid_ext(data->intel_fn13[i]);
+	}
+	data->xcr0[0] = data->xcr0[1] = 0;
+	if (data->basic_cpuid[0][0] >= 1 && (data->basic_cpuid[1][2] & (1 << 27)))
+		exec_xgetbv(0, data->xcr0);
 	for (i = 0; i < MAX_INTELFN11_LEVEL; i++) {
 		memset(data->intel_fn11[i], 0, sizeof(data->intel_fn11[i]));
 		data->intel_fn11[i][0] = 11;
 		data->intel_fn11[i][2] = i;
 		cpu_exec_cpuid_ext(data->intel_fn11[i]);
 	}
+	for (i = 0; i < MAX_INTELFN31_LEVEL; i++) {
+		memset(data->intel_fn31[i], 0, sizeof(data->intel_fn31[i]));
+		data->intel_fn31[i][0] = 31;
+		data->intel_fn31[i][2] = i;
+		cpu_exec_cpuid_ext(data->intel_fn31[i]);
+	}
+	for (i = 0; i < MAX_AMDFN8000001D_LEVEL; i++) {
+		memset(data->amd_fn8000001d[i], 0, sizeof(data->amd_fn8000001d[i]));
+		/* leaf 8000001Dh is only valid with TOPOEXT (8000_0001h ECX[22]) */
+		if (data->ext_cpuid[0][0] < 0x8000001d || !(data->ext_cpuid[1][2] & (1 << 22)))
+			continue;
+		data->amd_fn8000001d[i][0] = 0x8000001d;
+		data->amd_fn8000001d[i][2] = i;
+		cpu_exec_cpuid_ext(data->amd_fn8000001d[i]);
+	}
+}
+
+static uint32_t raw_data_apic_id(const struct cpu_raw_data_t* data)
+{
+	/* Prefer the full 32-bit x2APIC ID from leaf 0Bh, if it is implemented */
+	if (data->basic_cpuid[0][0] >= 11 && (data->intel_fn11[0][1] & 0xffff) != 0)
+		return data->intel_fn11[0][3];
+	return (data->basic_cpuid[1][1] >> 24) & 0xff;
+}
+
+int cpuid_get_raw_data(struct cpu_raw_data_t* data)
+{
+	if (!cpuid_present())
+		return set_error(ERR_NO_CPUID);
+	raw_data_fill(data);
 	return set_error(ERR_OK);
 }
 
+int cpuid_get_all_raw_data(struct cpu_raw_data_array_t* data)
+{
+	int i, j, r;
+	data->num_raw = 0;
+	data->cpus = NULL;
+	if (!cpuid_present())
+		return set_error(ERR_NO_CPUID);
+	if ((r = get_all_raw_data(data)) < 0)
+		return set_error(r);
+	/* drop the CPUs we failed to pin a thread to */
+	for (i = j = 0; i < data->num_raw; i++)
+		if (data->cpus[i].os_cpu >= 0)
+			data->cpus[j++] = data->cpus[i];
+	data->num_raw = j;
+	return set_error(ERR_OK);
+}
+
+void cpuid_free_raw_data_array(struct cpu_raw_data_array_t* data)
+{
+	free(data->cpus);
+	data->cpus = NULL;
+	data->num_raw = 0;
+}
+
 int cpuid_serialize_raw_data(struct cpu_raw_data_t* data, const char* filename)
 {
 	int i;
@@ -360,10 +663,27 @@ int cpuid_serialize_raw_data(struct cpu_raw_data_t* data, const char* filename)
 		fprintf(f, "intel_fn4[%d]=%08x %08x %08x %08x\n", i,
 			data->intel_fn4[i][0], data->intel_fn4[i][1],
 			data->intel_fn4[i][2], data->intel_fn4[i][3]);
+	for (i = 0; i < MAX_INTELFN7_LEVEL; i++)
+		fprintf(f, "intel_fn7[%d]=%08x %08x %08x %08x\n", i,
+			data->intel_fn7[i][0], data->intel_fn7[i][1],
+			data->intel_fn7[i][2], data->intel_fn7[i][3]);
 	for (i = 0; i < MAX_INTELFN11_LEVEL; i++)
 		fprintf(f, "intel_fn11[%d]=%08x %08x %08x %08x\n", i,
 			data->intel_fn11[i][0], data->intel_fn11[i][1],
 			data->intel_fn11[i][2], data->intel_fn11[i][3]);
+	for (i = 0; i < MAX_INTELFN13_LEVEL; i++)
+		fprintf(f, "intel_fn13[%d]=%08x %08x %08x %08x\n", i,
+			data->intel_fn13[i][0], data->intel_fn13[i][1],
+			data->intel_fn13[i][2], data->intel_fn13[i][3]);
+	fprintf(f, "xcr0=%08x %08x\n", data->xcr0[0], data->xcr0[1]);
+	for (i = 0; i < MAX_INTELFN31_LEVEL; i++)
+		fprintf(f, "intel_fn31[%d]=%08x %08x %08x %08x\n", i,
+			data->intel_fn31[i][0], data->intel_fn31[i][1],
+			data->intel_fn31[i][2], data->intel_fn31[i][3]);
+	for (i = 0; i < MAX_AMDFN8000001D_LEVEL; i++)
+		fprintf(f, "amd_fn8000001d[%d]=%08x %08x %08x %08x\n", i,
+			data->amd_fn8000001d[i][0], data->amd_fn8000001d[i][1],
+			data->amd_fn8000001d[i][2], data->amd_fn8000001d[i][3]);
 	
 	if (strcmp(filename, ""))
 		fclose(f);
@@ -410,8 +730,16 @@ int cpuid_deserialize_raw_data(struct cpu_raw_data_t* data, const char* filename
 		syntax = 1;
 		syntax = syntax && parse_token("basic_cpuid", token, value, data->basic_cpuid, 32, &recognized);
 		syntax = syntax && parse_token("ext_cpuid", token, value, data->ext_cpuid, 32, &recognized);
-		syntax = syntax && parse_token("intel_fn4", token, value, data->intel_fn4,  4, &recognized);
+		syntax = syntax && parse_token("intel_fn4", token, value, data->intel_fn4,  MAX_INTELFN4_LEVEL, &recognized);
+		syntax = syntax && parse_token("intel_fn7", token, value, data->intel_fn7,  MAX_INTELFN7_LEVEL, &recognized);
 		syntax = syntax && parse_token("intel_fn11", token, value, data->intel_fn11,  4, &recognized);
+		syntax = syntax && parse_token("intel_fn13", token, value, data->intel_fn13,  MAX_INTELFN13_LEVEL, &recognized);
+		syntax = syntax && parse_token("intel_fn31", token, value, data->intel_fn31,  MAX_INTELFN31_LEVEL, &recognized);
+		syntax = syntax && parse_token("amd_fn8000001d", token, value, data->amd_fn8000001d,  MAX_AMDFN8000001D_LEVEL, &recognized);
+		if (syntax && !recognized && !strcmp(token, "xcr0")) {
+			recognized = 1;
+			syntax = 2 == sscanf(value, "%x%x", &data->xcr0[0], &data->xcr0[1]);
+		}
 		if (!syntax) {
 			warnf("Error: %s:%d: Syntax error\n", filename, cur_line);
 			fclose(f);
@@ -545,6 +873,66 @@ const char* cpu_feature_str(cpu_feature_t feature)
 		{ CPU_FEATURE_TBM, "tbm" },
 		{ CPU_FEATURE_F16C, "f16c" },
 		{ CPU_FEATURE_RDRAND, "rdrand" },
+		{ CPU_FEATURE_FSGSBASE, "fsgsbase" },
+		{ CPU_FEATURE_BMI1, "bmi1" },
+		{ CPU_FEATURE_HLE, "hle" },
+		{ CPU_FEATURE_AVX2, "avx2" },
+		{ CPU_FEATURE_SMEP, "smep" },
+		{ CPU_FEATURE_BMI2, "bmi2" },
+		{ CPU_FEATURE_ERMS, "erms" },
+		{ CPU_FEATURE_INVPCID, "invpcid" },
+		{ CPU_FEATURE_RTM, "rtm" },
+		{ CPU_FEATURE_AVX512F, "avx512f" },
+		{ CPU_FEATURE_AVX512DQ, "avx512dq" },
+		{ CPU_FEATURE_RDSEED, "rdseed" },
+		{ CPU_FEATURE_ADX, "adx" },
+		{ CPU_FEATURE_SMAP, "smap" },
+		{ CPU_FEATURE_AVX512IFMA, "avx512ifma" },
+		{ CPU_FEATURE_CLFLUSHOPT, "clflushopt" },
+		{ CPU_FEATURE_CLWB, "clwb" },
+		{ CPU_FEATURE_AVX512PF, "avx512pf" },
+		{ CPU_FEATURE_AVX512ER, "avx512er" },
+		{ CPU_FEATURE_AVX512CD, "avx512cd" },
+		{ CPU_FEATURE_SHA_NI, "sha_ni" },
+		{ CPU_FEATURE_AVX512BW, "avx512bw" },
+		{ CPU_FEATURE_AVX512VL, "avx512vl" },
+		{ CPU_FEATURE_AVX512VBMI, "avx512vbmi" },
+		{ CPU_FEATURE_UMIP, "umip" },
+		{ CPU_FEATURE_PKU, "pku" },
+		{ CPU_FEATURE_WAITPKG, "waitpkg" },
+		{ CPU_FEATURE_AVX512VBMI2, "avx512vbmi2" },
+		{ CPU_FEATURE_GFNI, "gfni" },
+		{ CPU_FEATURE_VAES, "vaes" },
+		{ CPU_FEATURE_VPCLMULQDQ, "vpclmulqdq" },
+		{ CPU_FEATURE_AVX512VNNI, "avx512vnni" },
+		{ CPU_FEATURE_AVX512BITALG, "avx512bitalg" },
+		{ CPU_FEATURE_AVX512VPOPCNTDQ, "avx512vpopcntdq" },
+		{ CPU_FEATURE_RDPID, "rdpid" },
+		{ CPU_FEATURE_MOVDIRI, "movdiri" },
+		{ CPU_FEATURE_MOVDIR64B, "movdir64b" },
+		{ CPU_FEATURE_FSRM, "fsrm" },
+		{ CPU_FEATURE_AVX512VP2INTERSECT, "avx512vp2intersect" },
+		{ CPU_FEATURE_MD_CLEAR, "md_clear" },
+		{ CPU_FEATURE_SERIALIZE, "serialize" },
+		{ CPU_FEATURE_HYBRID, "hybrid" },
+		{ CPU_FEATURE_AMX_BF16, "amx_bf16" },
+		{ CPU_FEATURE_AVX512FP16, "avx512fp16" },
+		{ CPU_FEATURE_AMX_TILE, "amx_tile" },
+		{ CPU_FEATURE_AMX_INT8, "amx_int8" },
+		{ CPU_FEATURE_AVX_VNNI, "avx_vnni" },
+		{ CPU_FEATURE_AVX512BF16, "avx512bf16" },
+		{ CPU_FEATURE_FZLRM, "fzlrm" },
+		{ CPU_FEATURE_FSRS, "fsrs" },
+		{ CPU_FEATURE_FSRCS, "fsrcs" },
+		{ CPU_FEATURE_AMX_FP16, "amx_fp16" },
+		{ CPU_FEATURE_AVX_IFMA, "avx_ifma" },
+		{ CPU_FEATURE_AVX_VNNI_INT8, "avx_vnni_int8" },
+		{ CPU_FEATURE_AVX_NE_CONVERT, "avx_ne_convert" },
+		{ CPU_FEATURE_AVX10, "avx10" },
+		{ CPU_FEATURE_PSFD, "psfd" },
+		{ CPU_FEATURE_IPRED_CTRL, "ipred_ctrl" },
+		{ CPU_FEATURE_RRSBA_CTRL, "rrsba_ctrl" },
+		{ CPU_FEATURE_BHI_CTRL, "bhi_ctrl" },
 	};
 	unsigned i, n = COUNT_OF(matchtable);
 	if (n != NUM_CPU_FEATURES) {
@@ -568,6 +956,13 @@ const char* cpuid_error(void)
 		{ ERR_BADFMT   , "Bad file format"},
 		{ ERR_NOT_IMP  , "Not implemented"},
 		{ ERR_CPU_UNKN , "Unsupported processor"},
+		{ ERR_NO_RDMSR , "RDMSR instruction is not supported"},
+		{ ERR_NO_DRIVER, "RDMSR driver error (generic)"},
+		{ ERR_NO_PERMS , "No permissions to install RDMSR driver"},
+		{ ERR_EXTRACT  , "Cannot extract RDMSR driver (read only media?)"},
+		{ ERR_HANDLE   , "Bad handle"},
+		{ ERR_INVMSR   , "Invalid MSR"},
+		{ ERR_NO_INVTSC, "TSC is not invariant"},
 	};
 	unsigned i;
 	for (i = 0; i < COUNT_OF(matchtable); i++)
@@ -0,0 +1,191 @@
+/*
+ * Copyright 2026  cpuid-node contributors
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "libcpuid.h"
+#include "libcpuid_util.h"
+
+#if defined(__linux__)
+#include <unistd.h>
+#include <fcntl.h>
+
+struct cpu_times_reader_t {
+	int fd;
+	char* buf;
+	size_t size;
+};
+
+struct cpu_times_reader_t* cpu_times_open(const char* procfs_root)
+{
+	struct cpu_times_reader_t* reader;
+	char path[256];
+	long cpus = sysconf(_SC_NPROCESSORS_CONF);
+	
+	if (!procfs_root)
+		procfs_root = "/proc";
+	reader = (struct cpu_times_reader_t*) calloc(1, sizeof(struct cpu_times_reader_t));
+	if (!reader) {
+		set_error(ERR_NO_MEM);
+		return NULL;
+	}
+	/* Room for the cpu lines of all configured CPUs; grown on demand */
+	reader->size = 4096 + 160 * (cpus > 0 ? cpus : 1);
+	reader->buf = (char*) malloc(reader->size);
+	snprintf(path, sizeof(path), "%s/stat", procfs_root);
+	reader->fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (!reader->buf || reader->fd < 0) {
+		set_error(reader->buf ? ERR_NOT_IMP : ERR_NO_MEM);
+		free(reader->buf);
+		if (reader->fd >= 0)
+			close(reader->fd);
+		free(reader);
+		return NULL;
+	}
+	set_error(ERR_OK);
+	return reader;
+}
+
+/* Reads from the start of /proc/stat until past the last cpu line. The cpu
+   lines come first; the rest (notably the long "intr" line) is not needed. */
+static int read_cpu_lines(struct cpu_times_reader_t* reader, size_t* len)
+{
+	ssize_t got;
+	char* grown;
+	
+	for (;;) {
+		got = pread(reader->fd, reader->buf, reader->size - 1, 0);
+		if (got < 0)
+			return set_error(ERR_NOT_IMP);
+		reader->buf[got] = 0;
+		/* A line after the cpu lines, or the end of the file */
+		if ((size_t) got < reader->size - 1 || strstr(reader->buf, "\nintr ") ||
+		    strstr(reader->buf, "\nctxt ")) {
+			*len = (size_t) got;
+			return 0;
+		}
+		grown = (char*) realloc(reader->buf, reader->size * 2);
+		if (!grown)
+			return set_error(ERR_NO_MEM);
+		reader->buf = grown;
+		reader->size *= 2;
+	}
+}
+
+int cpu_times_read(struct cpu_times_reader_t* reader, struct cpu_times_t* times, int max_cpus)
+{
+	unsigned long long v[8];
+	char* line;
+	char* next;
+	size_t len;
+	int cpu, fields, n = 0;
+	
+	if (!reader || !times)
+		return set_error(ERR_HANDLE);
+	if (read_cpu_lines(reader, &len) < 0)
+		return get_error();
+	for (line = reader->buf; line && *line && n < max_cpus; line = next) {
+		next = strchr(line, '\n');
+		if (next)
+			*next++ = 0;
+		if (strncmp(line, "cpu", 3) != 0)
+			break;
+		/* Skip the aggregate "cpu " line */
+		if (line[3] < '0' || line[3] > '9')
+			continue;
+		memset(v, 0, sizeof(v));
+		fields = sscanf(line + 3, "%d %llu %llu %llu %llu %llu %llu %llu %llu", &cpu,
+		                &v[0], &v[1], &v[2], &v[3], &v[4], &v[5], &v[6], &v[7]);
+		if (fields < 5)
+			continue;
+		times[n].cpu = cpu;
+		times[n].user = v[0];
+		times[n].nice = v[1];
+		times[n].system = v[2];
+		times[n].idle = v[3];
+		times[n].iowait = v[4];
+		times[n].irq = v[5];
+		times[n].softirq = v[6];
+		times[n].steal = v[7];
+		n++;
+	}
+	set_error(ERR_OK);
+	return n;
+}
+
+void cpu_times_close(struct cpu_times_reader_t* reader)
+{
+	if (!reader) return;
+	close(reader->fd);
+	free(reader->buf);
+	free(reader);
+}
+
+int cpu_times_ticks_per_second(void)
+{
+	long hz = sysconf(_SC_CLK_TCK);
+	return hz > 0 ? (int) hz : 100;
+}
+
+#define CPU_TIMES_DEFINED
+#endif /* __linux__ */
+
+#ifndef CPU_TIMES_DEFINED
+struct cpu_times_reader_t* cpu_times_open(const char* procfs_root)
+{
+	set_error(ERR_NOT_IMP);
+	return NULL;
+}
+
+int cpu_times_read(struct cpu_times_reader_t* reader, struct cpu_times_t* times, int max_cpus)
+{
+	return set_error(ERR_NOT_IMP);
+}
+
+void cpu_times_close(struct cpu_times_reader_t* reader)
+{
+}
+
+int cpu_times_ticks_per_second(void)
+{
+	return 100;
+}
+#endif /* CPU_TIMES_DEFINED */
+
+double cpu_times_utilization(const struct cpu_times_t* before, const struct cpu_times_t* after)
+{
+	uint64_t idle0, idle1, total0, total1;
+	
+	if (!before || !after || before->cpu != after->cpu)
+		return -1;
+	idle0 = before->idle + before->iowait;
+	idle1 = after->idle + after->iowait;
+	total0 = idle0 + before->user + before->nice + before->system + before->irq + before->softirq + before->steal;
+	total1 = idle1 + after->user + after->nice + after->system + after->irq + after->softirq + after->steal;
+	/* The idle counters of a CPU that went offline and back start over */
+	if (total1 <= total0 || idle1 < idle0)
+		return -1;
+	return 1.0 - (double) (idle1 - idle0) / (double) (total1 - total0);
+}
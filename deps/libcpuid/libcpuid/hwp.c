@@ -0,0 +1,156 @@
+/*
+ * Copyright 2026  cpuid-node contributors
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "libcpuid.h"
+#include "libcpuid_util.h"
+
+#define MSR_IA32_HWP_CAPABILITIES 0x771
+
+static void perf_levels_t_constructor(struct cpu_perf_levels_t* levels, int cpu)
+{
+	memset(levels, 0, sizeof(struct cpu_perf_levels_t));
+	levels->cpu = cpu;
+	levels->highest = levels->guaranteed = levels->most_efficient = levels->lowest = -1;
+	levels->highest_mhz = -1;
+	levels->source = PERF_LEVELS_SOURCE_NONE;
+}
+
+int cpu_perf_levels_by_msr(struct msr_driver_t* handle, struct cpu_perf_levels_t* levels)
+{
+	struct cpu_id_t* id = get_cached_cpuid();
+	uint64_t r;
+	int err;
+	
+	perf_levels_t_constructor(levels, levels->cpu);
+	if (!handle)
+		return set_error(ERR_HANDLE);
+	if (!id || id->vendor != VENDOR_INTEL)
+		return set_error(ERR_CPU_UNKN);
+	/* Only implemented with HWP (CPUID.06H:EAX[7]); reading it fails otherwise */
+	if ((err = cpu_rdmsr(handle, MSR_IA32_HWP_CAPABILITIES, &r)) != 0)
+		return err;
+	levels->highest = (int) (r & 0xff);
+	levels->guaranteed = (int) ((r >> 8) & 0xff);
+	levels->most_efficient = (int) ((r >> 16) & 0xff);
+	levels->lowest = (int) ((r >> 24) & 0xff);
+	levels->source = PERF_LEVELS_SOURCE_HWP;
+	return set_error(ERR_OK);
+}
+
+static int read_cppc(const char* sysfs_root, int cpu, const char* name, long* value)
+{
+	char path[256];
+	FILE* f;
+	int ok;
+	snprintf(path, sizeof(path), "%s/devices/system/cpu/cpu%d/acpi_cppc/%s", sysfs_root, cpu, name);
+	if ((f = fopen(path, "rt")) == NULL)
+		return 0;
+	ok = fscanf(f, "%ld", value) == 1;
+	fclose(f);
+	return ok;
+}
+
+int cpu_perf_levels_by_cppc(const char* sysfs_root, int cpu, struct cpu_perf_levels_t* levels)
+{
+	long value, nominal_perf, nominal_freq;
+	
+	perf_levels_t_constructor(levels, cpu);
+	if (!sysfs_root)
+		sysfs_root = "/sys";
+	if (!read_cppc(sysfs_root, cpu, "highest_perf", &value))
+		return set_error(ERR_NOT_IMP);
+	levels->highest = (int) value;
+	/* guaranteed_perf is optional; nominal_perf is what the platform
+	   sustains without other constraints */
+	if (read_cppc(sysfs_root, cpu, "guaranteed_perf", &value) ||
+	    read_cppc(sysfs_root, cpu, "nominal_perf", &value))
+		levels->guaranteed = (int) value;
+	if (read_cppc(sysfs_root, cpu, "lowest_nonlinear_perf", &value))
+		levels->most_efficient = (int) value;
+	if (read_cppc(sysfs_root, cpu, "lowest_perf", &value))
+		levels->lowest = (int) value;
+	/* The performance scale is abstract; nominal_freq anchors it */
+	if (read_cppc(sysfs_root, cpu, "nominal_perf", &nominal_perf) && nominal_perf > 0 &&
+	    read_cppc(sysfs_root, cpu, "nominal_freq", &nominal_freq) && nominal_freq > 0)
+		levels->highest_mhz = (int) (levels->highest * nominal_freq / nominal_perf);
+	levels->source = PERF_LEVELS_SOURCE_CPPC;
+	return set_error(ERR_OK);
+}
+
+int cpu_perf_levels_read_all(struct msr_cpu_set_t* set, const char* sysfs_root, struct cpu_perf_levels_t* levels, int max_cpus)
+{
+	int cpu, n = 0;
+	
+	if (!levels || max_cpus < 0)
+		return set_error(ERR_HANDLE);
+	for (cpu = 0; cpu < max_cpus; cpu++) {
+		levels[n].cpu = cpu;
+		if (set && cpu_msr_set_handle(set, cpu) &&
+		    cpu_perf_levels_by_msr(cpu_msr_set_handle(set, cpu), &levels[n]) == 0) {
+			n++;
+			continue;
+		}
+		if (cpu_perf_levels_by_cppc(sysfs_root, cpu, &levels[n]) == 0)
+			n++;
+	}
+	set_error(n ? ERR_OK : ERR_NOT_IMP);
+	return n;
+}
+
+static int compare_perf_levels(const void* a, const void* b)
+{
+	const struct cpu_perf_levels_t* x = (const struct cpu_perf_levels_t*) a;
+	const struct cpu_perf_levels_t* y = (const struct cpu_perf_levels_t*) b;
+	if (x->highest != y->highest)
+		return y->highest - x->highest;
+	if (x->guaranteed != y->guaranteed)
+		return y->guaranteed - x->guaranteed;
+	return x->cpu - y->cpu;
+}
+
+void cpu_perf_levels_rank(struct cpu_perf_levels_t* levels, int count)
+{
+	int i;
+	if (!levels || count <= 0) return;
+	qsort(levels, count, sizeof(struct cpu_perf_levels_t), compare_perf_levels);
+	for (i = 0; i < count; i++) {
+		if (i > 0 && levels[i].highest == levels[i - 1].highest &&
+		    levels[i].guaranteed == levels[i - 1].guaranteed)
+			levels[i].rank = levels[i - 1].rank;
+		else
+			levels[i].rank = i > 0 ? levels[i - 1].rank + 1 : 0;
+	}
+}
+
+const char* cpu_perf_levels_source_str(cpu_perf_levels_source_t source)
+{
+	switch (source) {
+		case PERF_LEVELS_SOURCE_HWP: return "hwp";
+		case PERF_LEVELS_SOURCE_CPPC: return "cppc";
+		default: return "none";
+	}
+}
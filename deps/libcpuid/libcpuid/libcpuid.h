@@ -112,10 +112,62 @@ struct cpu_raw_data_t {
 	    and ecx = 0, 1, ... */
 	uint32_t intel_fn4[MAX_INTELFN4_LEVEL][4];
 	
+	/** when the CPU supports leaf 7 (Structured Extended Feature Flags),
+	    this contains the results of CPUID for eax = 7 and ecx = 0, 1, ...
+	    Subleaf 0 is the same as basic_cpuid[7] */
+	uint32_t intel_fn7[MAX_INTELFN7_LEVEL][4];
+	
 	/** when the CPU is intel and it supports leaf 0Bh (Extended Topology
 	    enumeration leaf), this stores the result of CPUID with 
 	    eax = 11 and ecx = 0, 1, 2... */
 	uint32_t intel_fn11[MAX_INTELFN11_LEVEL][4];
+	
+	/** when the CPU supports leaf 0Dh (Processor Extended State
+	    Enumeration), this contains the results of CPUID for eax = 13 and
+	    ecx = 0, 1, ... Subleafs 2 and up give the size of the XSAVE state
+	    component with that number */
+	uint32_t intel_fn13[MAX_INTELFN13_LEVEL][4];
+	
+	/** when the OS has enabled XSAVE (CPUID.1:ECX[27] is set), this
+	    contains the XCR0 register (the state components the OS saves on
+	    context switch), as read by XGETBV: low half first. Zero otherwise */
+	uint32_t xcr0[2];
+	
+	/** when the CPU supports leaf 1Fh (V2 Extended Topology enumeration
+	    leaf), this stores the result of CPUID with eax = 31 and
+	    ecx = 0, 1, 2... */
+	uint32_t intel_fn31[MAX_INTELFN31_LEVEL][4];
+	
+	/** when the CPU is AMD and it supports the topology extensions, this
+	    contains the results of CPUID for eax = 0x8000001D and
+	    ecx = 0, 1, ... (the AMD counterpart of leaf 4) */
+	uint32_t amd_fn8000001d[MAX_AMDFN8000001D_LEVEL][4];
+};
+
+/**
+ * @brief Contains the raw CPUID data of a single logical CPU
+ * @see cpuid_get_all_raw_data
+ */
+struct cpu_logical_raw_t {
+	/** the OS index of the logical CPU the data was read on */
+	int32_t os_cpu;
+	
+	/** the initial APIC ID of that logical CPU (the x2APIC ID, if supported) */
+	uint32_t apic_id;
+	
+	/** the raw CPUID data, as read on that logical CPU */
+	struct cpu_raw_data_t raw;
+};
+
+/**
+ * @brief Contains the raw CPUID data of all logical CPUs
+ * @see cpuid_get_all_raw_data
+ */
+struct cpu_raw_data_array_t {
+	/** Number of entries in the array */
+	int num_raw;
+	/** The per-CPU data, ordered by os_cpu. There will be num_raw of them */
+	struct cpu_logical_raw_t* cpus;
 };
 
 /**
@@ -349,6 +401,66 @@ typedef enum {
 	CPU_FEATURE_TBM,	/*!< Trailing bit manipulation instruction support */
 	CPU_FEATURE_F16C,	/*!< 16-bit FP convert instruction support */
 	CPU_FEATURE_RDRAND,     /*!< RdRand instruction */
+	CPU_FEATURE_FSGSBASE,	/*!< RDFSBASE / WRFSBASE / RDGSBASE / WRGSBASE instructions */
+	CPU_FEATURE_BMI1,	/*!< Bit manipulation instructions, group 1 */
+	CPU_FEATURE_HLE,	/*!< Hardware lock elision */
+	CPU_FEATURE_AVX2,	/*!< The AVX2 instruction set */
+	CPU_FEATURE_SMEP,	/*!< Supervisor mode execution prevention */
+	CPU_FEATURE_BMI2,	/*!< Bit manipulation instructions, group 2 */
+	CPU_FEATURE_ERMS,	/*!< Enhanced REP MOVSB / STOSB */
+	CPU_FEATURE_INVPCID,	/*!< INVPCID instruction */
+	CPU_FEATURE_RTM,	/*!< Restricted transactional memory */
+	CPU_FEATURE_AVX512F,	/*!< AVX-512 Foundation */
+	CPU_FEATURE_AVX512DQ,	/*!< AVX-512 Doubleword and Quadword instructions */
+	CPU_FEATURE_RDSEED,	/*!< RDSEED instruction */
+	CPU_FEATURE_ADX,	/*!< ADCX / ADOX multi-precision add instructions */
+	CPU_FEATURE_SMAP,	/*!< Supervisor mode access prevention */
+	CPU_FEATURE_AVX512IFMA,	/*!< AVX-512 Integer fused multiply-add */
+	CPU_FEATURE_CLFLUSHOPT,	/*!< CLFLUSHOPT instruction */
+	CPU_FEATURE_CLWB,	/*!< CLWB instruction */
+	CPU_FEATURE_AVX512PF,	/*!< AVX-512 Prefetch instructions */
+	CPU_FEATURE_AVX512ER,	/*!< AVX-512 Exponential and reciprocal instructions */
+	CPU_FEATURE_AVX512CD,	/*!< AVX-512 Conflict detection instructions */
+	CPU_FEATURE_SHA_NI,	/*!< SHA-1 / SHA-256 instructions */
+	CPU_FEATURE_AVX512BW,	/*!< AVX-512 Byte and Word instructions */
+	CPU_FEATURE_AVX512VL,	/*!< AVX-512 Vector length extensions */
+	CPU_FEATURE_AVX512VBMI,	/*!< AVX-512 Vector byte manipulation instructions */
+	CPU_FEATURE_UMIP,	/*!< User-mode instruction prevention */
+	CPU_FEATURE_PKU,	/*!< Memory protection keys for user-mode pages */
+	CPU_FEATURE_WAITPKG,	/*!< UMONITOR / UMWAIT / TPAUSE instructions */
+	CPU_FEATURE_AVX512VBMI2,	/*!< AVX-512 Vector byte manipulation instructions 2 */
+	CPU_FEATURE_GFNI,	/*!< Galois field instructions */
+	CPU_FEATURE_VAES,	/*!< Vector AES instructions */
+	CPU_FEATURE_VPCLMULQDQ,	/*!< Vector carry-less multiplication */
+	CPU_FEATURE_AVX512VNNI,	/*!< AVX-512 Vector neural network instructions */
+	CPU_FEATURE_AVX512BITALG,	/*!< AVX-512 Bit algorithms */
+	CPU_FEATURE_AVX512VPOPCNTDQ,	/*!< AVX-512 Vector population count for doubleword and quadword */
+	CPU_FEATURE_RDPID,	/*!< RDPID instruction */
+	CPU_FEATURE_MOVDIRI,	/*!< MOVDIRI instruction */
+	CPU_FEATURE_MOVDIR64B,	/*!< MOVDIR64B instruction */
+	CPU_FEATURE_FSRM,	/*!< Fast short REP MOVSB */
+	CPU_FEATURE_AVX512VP2INTERSECT,	/*!< AVX-512 VP2INTERSECT instructions */
+	CPU_FEATURE_MD_CLEAR,	/*!< VERW clears CPU buffers */
+	CPU_FEATURE_SERIALIZE,	/*!< SERIALIZE instruction */
+	CPU_FEATURE_HYBRID,	/*!< Hybrid part (cores of more than one type) */
+	CPU_FEATURE_AMX_BF16,	/*!< AMX tile computation on bfloat16 */
+	CPU_FEATURE_AVX512FP16,	/*!< AVX-512 half-precision floating point instructions */
+	CPU_FEATURE_AMX_TILE,	/*!< AMX tile architecture */
+	CPU_FEATURE_AMX_INT8,	/*!< AMX tile computation on 8-bit integers */
+	CPU_FEATURE_AVX_VNNI,	/*!< AVX (VEX-encoded) vector neural network instructions */
+	CPU_FEATURE_AVX512BF16,	/*!< AVX-512 bfloat16 instructions */
+	CPU_FEATURE_FZLRM,	/*!< Fast zero-length REP MOVSB */
+	CPU_FEATURE_FSRS,	/*!< Fast short REP STOSB */
+	CPU_FEATURE_FSRCS,	/*!< Fast short REP CMPSB / SCASB */
+	CPU_FEATURE_AMX_FP16,	/*!< AMX tile computation on FP16 */
+	CPU_FEATURE_AVX_IFMA,	/*!< AVX (VEX-encoded) integer fused multiply-add */
+	CPU_FEATURE_AVX_VNNI_INT8,	/*!< AVX VNNI on 8-bit integers */
+	CPU_FEATURE_AVX_NE_CONVERT,	/*!< AVX no-exception FP conversion instructions */
+	CPU_FEATURE_AVX10,	/*!< AVX10 converged vector ISA */
+	CPU_FEATURE_PSFD,	/*!< Predictive store forwarding disable */
+	CPU_FEATURE_IPRED_CTRL,	/*!< Indirect predictor controls */
+	CPU_FEATURE_RRSBA_CTRL,	/*!< RRSBA behavior disable */
+	CPU_FEATURE_BHI_CTRL,	/*!< Branch history injection control */
 	/* termination: */
 	NUM_CPU_FEATURES,
 } cpu_feature_t;
@@ -382,6 +494,7 @@ typedef enum {
 	ERR_EXTRACT  = -11,	/*!< "Cannot extract RDMSR driver (read only media?)" */
 	ERR_HANDLE   = -12,	/*!< "Bad handle" */
 	ERR_INVMSR   = -13,     /*!< "Invalid MSR" */
+	ERR_NO_INVTSC= -14,	/*!< "TSC is not invariant" */
 } cpu_error_t;
 
 /**
@@ -428,6 +541,255 @@ void cpu_exec_cpuid_ext(uint32_t* regs);
  */
 int cpuid_get_raw_data(struct cpu_raw_data_t* data);
 
+/**
+ * @brief Obtains the raw CPUID data from every logical CPU
+ *
+ * A thread is pinned to each logical CPU the process is allowed to run on, and
+ * reads the raw CPUID data there. The threads run in parallel, so the whole
+ * sweep takes about as long as a single \ref cpuid_get_raw_data call. This
+ * reveals differences between CPUs that a single probe hides, e.g. on hybrid
+ * processors or multi-socket systems with mixed steppings.
+ *
+ * @param data - a pointer to cpu_raw_data_array_t structure. The array is
+ *               allocated by the function; free it with
+ *               \ref cpuid_free_raw_data_array when done.
+ * @note On systems where threads cannot be pinned, the array contains a single
+ *       entry for the CPU the caller happens to run on.
+ * @returns zero if successful, and some negative number on error.
+ *          The error message can be obtained by calling \ref cpuid_error.
+ *          @see cpu_error_t
+ */
+int cpuid_get_all_raw_data(struct cpu_raw_data_array_t* data);
+
+/**
+ * @brief Frees the per-CPU raw data obtained by \ref cpuid_get_all_raw_data
+ *
+ * @param data - the array to be free()'d.
+ */
+void cpuid_free_raw_data_array(struct cpu_raw_data_array_t* data);
+
+/**
+ * @brief Describes the position of a logical CPU in the system topology
+ * @see cpuid_get_topology
+ */
+struct cpu_topology_entry_t {
+	/** the OS index of the logical CPU */
+	int32_t os_cpu;
+	
+	/** the initial APIC ID of the logical CPU (the x2APIC ID, if supported) */
+	uint32_t apic_id;
+	
+	/** the physical package (socket) ID, as encoded in the APIC ID */
+	int32_t package_id;
+	
+	/** the core ID, unique within the package */
+	int32_t core_id;
+	
+	/** the hardware thread (SMT) ID, unique within the core */
+	int32_t smt_id;
+};
+
+/**
+ * @brief Contains the package / core / thread map of all logical CPUs
+ * @see cpuid_get_topology
+ */
+struct cpu_topology_t {
+	/** Number of low-order APIC ID bits which select the thread in a core */
+	int32_t smt_shift;
+	
+	/** Number of low-order APIC ID bits below the package ID */
+	int32_t pkg_shift;
+	
+	/** Number of distinct physical packages */
+	int32_t num_packages;
+	
+	/** Number of distinct physical cores, in all packages */
+	int32_t num_cores;
+	
+	/** Number of entries in the array */
+	int num_entries;
+	
+	/** One entry per logical CPU, sorted by package, core and thread. There
+	    will be num_entries of them */
+	struct cpu_topology_entry_t* entries;
+};
+
+/**
+ * @brief Builds the package / core / thread map of the system
+ *
+ * The APIC ID of every logical CPU is split into package, core and thread
+ * fields, using the shift widths from leaf 1Fh or 0Bh (or the legacy leaf 1,
+ * 4 and 80000008h counts on older processors).
+ *
+ * @param raw - Input - the per-CPU raw data, as obtained by
+ *              \ref cpuid_get_all_raw_data
+ * @param topo - Output - the topology map. It is allocated by the function;
+ *               free it with \ref cpuid_free_topology when done.
+ * @returns zero if successful, and some negative number on error.
+ *          The error message can be obtained by calling \ref cpuid_error.
+ *          @see cpu_error_t
+ */
+int cpuid_get_topology(const struct cpu_raw_data_array_t* raw, struct cpu_topology_t* topo);
+
+/**
+ * @brief Frees the topology map obtained by \ref cpuid_get_topology
+ *
+ * @param topo - the map to be free()'d.
+ */
+void cpuid_free_topology(struct cpu_topology_t* topo);
+
+/**
+ * @brief Describes one physical cache instance and the CPUs that share it
+ * @see cpuid_get_cache_topology
+ */
+struct cpu_cache_instance_t {
+	/** cache level (1, 2, 3...) */
+	int32_t level;
+	
+	/** cache type, as encoded in leaf 4 / 8000001Dh: 1 = data,
+	    2 = instruction, 3 = unified */
+	int32_t type;
+	
+	/** cache size, in KB */
+	int32_t size;
+	
+	/** cache line size, in bytes */
+	int32_t linesize;
+	
+	/** ID of the instance, i.e. the APIC ID bits above the sharing field.
+	    Unique among instances of the same level and type */
+	int32_t cache_id;
+	
+	/** Number of logical CPUs in the os_cpus array */
+	int num_cpus;
+	
+	/** OS indices of the logical CPUs sharing this instance, ascending */
+	int32_t* os_cpus;
+};
+
+/**
+ * @brief Contains all cache instances of the system
+ * @see cpuid_get_cache_topology
+ */
+struct cpu_cache_topology_t {
+	/** Number of entries in the array */
+	int num_caches;
+	
+	/** The cache instances, sorted by level, type and ID. There will be
+	    num_caches of them */
+	struct cpu_cache_instance_t* caches;
+};
+
+/**
+ * @brief Finds out which logical CPUs share each cache
+ *
+ * The deterministic cache leaf (4 on Intel, 8000001Dh on AMD) of every
+ * logical CPU reports how many logical processors share each of its caches.
+ * Grouping the CPUs by the APIC ID bits above that field gives the sharing
+ * sets, e.g. the cores of one L3 slice or AMD CCX.
+ *
+ * @param raw - Input - the per-CPU raw data, as obtained by
+ *              \ref cpuid_get_all_raw_data
+ * @param caches - Output - the cache instances. They are allocated by the
+ *                 function; free them with \ref cpuid_free_cache_topology.
+ * @returns zero if successful, and some negative number on error.
+ *          The error message can be obtained by calling \ref cpuid_error.
+ *          @see cpu_error_t
+ */
+int cpuid_get_cache_topology(const struct cpu_raw_data_array_t* raw, struct cpu_cache_topology_t* caches);
+
+/**
+ * @brief Frees the data obtained by \ref cpuid_get_cache_topology
+ *
+ * @param caches - the data to be free()'d.
+ */
+void cpuid_free_cache_topology(struct cpu_cache_topology_t* caches);
+
+/**
+ * @brief The instruction set tiers that \ref cpuid_get_usable_isa picks from
+ */
+typedef enum {
+	ISA_TIER_NONE = 0,	/*!< Not even SSE2 is usable */
+	ISA_TIER_SSE2,		/*!< SSE, SSE2 */
+	ISA_TIER_SSE4_2,	/*!< up to SSE4.2 and POPCNT (x86-64-v2) */
+	ISA_TIER_AVX,		/*!< AVX, with the YMM state saved by the OS */
+	ISA_TIER_AVX2,		/*!< AVX2, FMA3, BMI1/2, F16C, MOVBE */
+	ISA_TIER_AVX512,	/*!< AVX-512 F/CD/BW/DQ/VL (x86-64-v4), with the ZMM state saved by the OS */
+	NUM_ISA_TIERS,
+} cpu_isa_tier_t;
+
+/**
+ * @brief Describes which SIMD instruction sets can actually be used
+ *
+ * The CPU_FEATURE_AVX* flags only say what the processor implements. Using
+ * the wider registers also requires the OS to save their state on context
+ * switch, which it signals through XCR0. Hypervisors sometimes advertise
+ * AVX while leaving it disabled there.
+ *
+ * @see cpuid_get_usable_isa
+ */
+struct cpu_usable_isa_t {
+	/** The XCR0 register, or zero if the OS has not enabled XSAVE */
+	uint64_t xcr0;
+	
+	/** Size in bytes of the XSAVE area for the components enabled in XCR0
+	    (leaf 0Dh EBX), or zero if XSAVE is not enabled */
+	int32_t xsave_size;
+	
+	/** Size in bytes of the XSAVE area for every component the processor
+	    supports (leaf 0Dh ECX), or zero if XSAVE is not enabled */
+	int32_t xsave_max_size;
+	
+	/** 1 if SSE and SSE2 are usable */
+	uint8_t sse2;
+	
+	/** 1 if everything up to SSE4.2 is usable, including POPCNT and CX16 */
+	uint8_t sse4_2;
+	
+	/** 1 if AVX is implemented and the OS saves the YMM state */
+	uint8_t avx;
+	
+	/** 1 if AVX is usable and AVX2, FMA3, BMI1, BMI2, F16C and MOVBE are
+	    implemented */
+	uint8_t avx2;
+	
+	/** 1 if AVX2 is usable, AVX-512 F, CD, BW, DQ and VL are implemented,
+	    and the OS saves the opmask and ZMM state */
+	uint8_t avx512;
+	
+	/** 1 if AMX-TILE is implemented and the OS has enabled the tile state
+	    in XCR0. (Linux still requires each process to request permission
+	    with arch_prctl(ARCH_REQ_XCOMP_PERM) before using it) */
+	uint8_t amx;
+	
+	/** The best of the above, as a single tier */
+	cpu_isa_tier_t tier;
+};
+
+/**
+ * @brief Works out which SIMD instruction sets are safe to use
+ *
+ * Combines the CPUID feature bits with XCR0 and the leaf 0Dh state component
+ * sizes, so that code can dispatch on the result without further checks.
+ *
+ * @param raw - Input - the raw CPUID data, as obtained by
+ *              \ref cpuid_get_raw_data (XCR0 is read along with it)
+ * @param isa - Output - the usable instruction sets
+ * @returns zero if successful, and some negative number on error.
+ *          The error message can be obtained by calling \ref cpuid_error.
+ *          @see cpu_error_t
+ */
+int cpuid_get_usable_isa(const struct cpu_raw_data_t* raw, struct cpu_usable_isa_t* isa);
+
+/**
+ * @brief Returns the short name of an instruction set tier
+ *
+ * @param tier - the tier, e.g. ISA_TIER_AVX2
+ *
+ * @returns a constant string like "sse4.2", "avx2" or "avx512"
+ */
+const char* cpu_isa_tier_str(cpu_isa_tier_t tier);
+
 /**
  * @brief Writes the raw CPUID data to a text file
  * @param data - a pointer to cpu_raw_data_t structure
@@ -648,6 +1010,45 @@ int cpu_clock_by_os(void);
  */
 int cpu_clock_measure(int millis, int quad_check);
 
+/**
+ * @brief The result of \ref cpu_clock_measure_adaptive
+ */
+struct cpu_clock_estimate_t {
+	/** The estimated frequency, in MHz */
+	double mhz;
+	
+	/** Half-width of the 95% confidence interval of mhz */
+	double error_mhz;
+	
+	/** Number of measurement windows the estimate is based on */
+	int windows;
+	
+	/** Time spent measuring, in milliseconds */
+	int elapsed_ms;
+};
+
+/**
+ * @brief Measure the CPU clock frequency, stopping as soon as it is known
+ *
+ * Like \ref cpu_clock_measure, this busy-waits and compares the TSC with
+ * the OS clock, but in windows of about a millisecond. It stops as soon as
+ * the confidence interval of the mean of the windows is within the given
+ * relative tolerance, or when the time budget is used up, whichever comes
+ * first. On a quiet machine a tolerance of 1e-3 is met after a handful of
+ * windows; on a noisy one the measurement runs longer, up to budget_ms.
+ *
+ * The first window is discarded, to give the power manager a moment to
+ * raise the clock.
+ *
+ * @param tolerance - the relative error to stop at, e.g. 0.001 for 0.1%
+ * @param budget_ms - the longest time to measure for, in milliseconds
+ * @param estimate - Output - the frequency and its error bound. May be NULL.
+ *
+ * @returns the CPU clock frequency in MHz, rounded, or -1 on error (bad
+ *          parameters, or a clock that does not advance).
+ */
+int cpu_clock_measure_adaptive(double tolerance, int budget_ms, struct cpu_clock_estimate_t* estimate);
+
 /**
  * @brief Measure the CPU clock frequency using instruction-counting
  *
@@ -680,6 +1081,128 @@ int cpu_clock_measure(int millis, int quad_check);
  */
 int cpu_clock_by_ic(int millis, int runs);
 
+/**
+ * @brief Reads the TSC after all previous instructions have executed
+ *
+ * Like \ref cpu_rdtsc, but uses the RDTSCP instruction, which waits for
+ * the preceding instructions to complete before reading the counter. Check
+ * the rdtscp field of \ref cpu_tsc_calibration_t (or CPUID 80000001h
+ * EDX[27]) before calling it.
+ *
+ * @param result - a pointer to a 64-bit unsigned integer, where the TSC value
+ *                 will be stored
+ */
+void cpu_rdtscp(uint64_t* result);
+
+/**
+ * @brief The relation between the TSC and the OS monotonic clock
+ * @see cpu_tsc_calibrate
+ */
+struct cpu_tsc_calibration_t {
+	/** TSC value at the reference point */
+	uint64_t tsc_base;
+	
+	/** OS monotonic clock (CLOCK_MONOTONIC_RAW on Linux, or its
+	    equivalent elsewhere) at the reference point, in nanoseconds */
+	uint64_t ns_base;
+	
+	/** TSC frequency, in Hz */
+	double hz;
+	
+	/** Nanoseconds per TSC tick, i.e. 1e9 / hz */
+	double ns_per_tick;
+	
+	/** Half-width of the 95% confidence interval of hz, in Hz */
+	double hz_error;
+	
+	/** Number of paired readings the fit was made from */
+	int samples;
+	
+	/** 1 if the RDTSCP instruction is available */
+	int rdtscp;
+};
+
+/**
+ * @brief Calibrates the TSC against the OS monotonic clock
+ *
+ * Reads the TSC and the monotonic clock together (keeping the tightest of a
+ * few paired readings) about once per millisecond, sleeping in between, and
+ * fits a line through the readings by least squares. The TSC can only be
+ * used as a clock if it is invariant, i.e. it ticks at a constant rate
+ * regardless of frequency scaling and C-states, so that is checked first
+ * (CPUID 80000007h EDX[8]).
+ *
+ * @param millis - length of the calibration interval. 20 ms typically gives
+ *                 a confidence interval well below 1e-5 of the frequency.
+ * @param cal - Output - the calibration
+ *
+ * @returns zero if successful, ERR_NO_INVTSC if the TSC is not invariant,
+ *          and some other negative number on error. The error message can be
+ *          obtained by calling \ref cpuid_error.
+ */
+int cpu_tsc_calibrate(int millis, struct cpu_tsc_calibration_t* cal);
+
+/**
+ * @brief Where \ref cpu_clock_resolve found the clock frequency
+ */
+typedef enum {
+	CLOCK_SOURCE_NONE = 0,	/*!< No frequency could be found */
+	CLOCK_SOURCE_CPUID_16H,	/*!< CPUID leaf 16h (Processor Frequency Information) */
+	CLOCK_SOURCE_CPUID_15H,	/*!< CPUID leaf 15h (TSC / Core Crystal Clock ratio) */
+	CLOCK_SOURCE_SYSFS,	/*!< Linux cpufreq base_frequency or cpuinfo_max_freq */
+	CLOCK_SOURCE_OS,	/*!< \ref cpu_clock_by_os */
+	CLOCK_SOURCE_MEASURED,	/*!< \ref cpu_clock_measure_adaptive (busy-waits up to 200 ms) */
+	NUM_CLOCK_SOURCES,
+} cpu_clock_source_t;
+
+/**
+ * @brief The nominal clock frequencies of the processor
+ * @see cpu_clock_resolve
+ */
+struct cpu_clock_info_t {
+	/** Base (nominal) frequency in MHz, or -1 if unknown */
+	int base_mhz;
+	
+	/** Maximum (single-core turbo) frequency in MHz, or -1 if unknown */
+	int max_mhz;
+	
+	/** Bus (reference) frequency in MHz, or -1 if unknown */
+	int bus_mhz;
+	
+	/** TSC frequency in Hz from leaf 15h, or 0 if it is not enumerated */
+	double tsc_hz;
+	
+	/** 1 if the TSC is invariant (CPUID 80000007h EDX[8]) */
+	int invariant_tsc;
+	
+	/** Where base_mhz came from */
+	cpu_clock_source_t source;
+};
+
+/**
+ * @brief Finds the nominal CPU clock, busy-waiting only as a last resort
+ *
+ * The sources are tried from cheapest to most expensive: CPUID leaves 16h
+ * and 15h, then (on Linux) the cpufreq base_frequency and cpuinfo_max_freq
+ * attributes, then \ref cpu_clock_by_os, and finally
+ * \ref cpu_clock_measure_adaptive. On recent Intel processors the result therefore
+ * needs no system calls at all.
+ *
+ * Unlike \ref cpu_clock, which prefers the current frequency reported by
+ * the OS, this returns the nominal one whenever it is available.
+ *
+ * @param raw - the raw CPUID data, or NULL to have it obtained
+ * @param info - Output - the frequencies found, and their source
+ *
+ * @returns the base frequency in MHz, or -1 if every method failed.
+ */
+int cpu_clock_resolve(const struct cpu_raw_data_t* raw, struct cpu_clock_info_t* info);
+
+/**
+ * @brief Returns the short name of a clock source, e.g. "cpuid-16h"
+ */
+const char* cpu_clock_source_str(cpu_clock_source_t source);
+
 /**
  * @brief Get the CPU clock frequency (all-in-one method)
  *
@@ -781,6 +1304,19 @@ void cpuid_free_cpu_list(struct cpu_list_t* list);
 struct msr_driver_t;
 struct msr_driver_t* cpu_msr_driver_open(void);
 
+/**
+ * @brief Similar to \ref cpu_msr_driver_open, but for the given CPU
+ *
+ * On Linux this opens /dev/cpu/<core_num>/msr; reads through the handle
+ * return the MSRs of that CPU. Elsewhere only CPU 0 is supported.
+ *
+ * @param core_num - the OS number of the CPU
+ *
+ * @returns a handle to the driver, or NULL on error (see
+ *          \ref cpu_msr_driver_open).
+ */
+struct msr_driver_t* cpu_msr_driver_open_core(unsigned core_num);
+
 /**
  * @brief Reads a Model-Specific Register (MSR)
  *
@@ -805,22 +1341,27 @@ struct msr_driver_t* cpu_msr_driver_open(void);
  *          The error message can be obtained by calling \ref cpuid_error.
  *          @see cpu_error_t
  */
-int cpu_rdmsr(struct msr_driver_t* handle, int msr_index, uint64_t* result);
+int cpu_rdmsr(struct msr_driver_t* handle, uint32_t msr_index, uint64_t* result);
 
 
 typedef enum {
 	INFO_MPERF,                /*!< Maximum performance frequency clock. This
                                     is a counter, which increments as a
-                                    proportion of the actual processor speed */
+                                    proportion of the actual processor speed.
+                                    Returns its rate in MHz since the previous
+                                    INFO_MPERF query on the same handle (or
+                                    since it was opened). */
 	INFO_APERF,                /*!< Actual performance frequency clock. This
                                     accumulates the core clock counts when the
-                                    core is active. */
+                                    core is active. Returns its rate like
+                                    INFO_MPERF. */
 	INFO_CUR_MULTIPLIER,       /*!< Current CPU:FSB ratio, multiplied by 100.
                                     e.g., a CPU:FSB value of 18.5 reads as
                                     1850. */
 	INFO_MAX_MULTIPLIER,       /*!< Maxumum CPU:FSB ratio for this CPU,
                                     multiplied by 100 */
-	INFO_TEMPERATURE,          /*!< The current core temperature in Celsius */
+	INFO_TEMPERATURE,          /*!< The current core temperature in Celsius
+                                    (Intel only, see \ref cpu_thermal_by_msr) */
 	INFO_THROTTLING,           /*!< 1 if the current logical processor is
                                     throttling. 0 if it is running normally. */
 } cpu_msrinfo_request_t;
@@ -854,6 +1395,834 @@ int cpu_msrinfo(struct msr_driver_t* handle, cpu_msrinfo_request_t which);
  */
 int cpu_msr_driver_close(struct msr_driver_t* handle);
 
+/**
+ * @brief MSR driver handles for every online CPU
+ * @see cpu_msr_open_all
+ */
+struct msr_cpu_set_t;
+
+/**
+ * @brief Opens an MSR driver handle for each online CPU
+ *
+ * The handles stay open until \ref cpu_msr_close_all, so repeated reads
+ * cost one system call each. CPUs that cannot be opened (e.g. offline
+ * ones) get no handle. Only implemented on Linux.
+ *
+ * @returns the set, or NULL if no CPU could be opened; the error message
+ *          can then be obtained by calling \ref cpuid_error.
+ */
+struct msr_cpu_set_t* cpu_msr_open_all(void);
+
+/**
+ * @brief Returns the highest CPU number in the set plus one
+ */
+int cpu_msr_set_size(struct msr_cpu_set_t* set);
+
+/**
+ * @brief Returns the handle of one CPU in the set
+ *
+ * The handle belongs to the set; do not close it.
+ *
+ * @returns the handle, or NULL if that CPU has none.
+ */
+struct msr_driver_t* cpu_msr_set_handle(struct msr_cpu_set_t* set, int cpu);
+
+/**
+ * @brief One MSR read of a batch
+ * @see cpu_rdmsr_batch
+ */
+struct msr_request_t {
+	/** Input: the OS number of the CPU */
+	int cpu;
+	
+	/** Input: the MSR index */
+	uint32_t msr;
+	
+	/** Output: the MSR value, or 0 if the read failed */
+	uint64_t value;
+	
+	/** Output: zero if the read succeeded, a negative error code otherwise */
+	int error;
+};
+
+/**
+ * @brief Reads a list of (cpu, msr) pairs in one call
+ *
+ * Fills the value and error of each request. Every read is a synchronous
+ * call to the CPU that owns the register, so large batches are split by
+ * CPU over several threads, each reading the requests of its own CPUs.
+ *
+ * @param set - the handles, from \ref cpu_msr_open_all
+ * @param requests - the caller-owned list of requests
+ * @param count - the number of requests
+ * @param threads - the number of threads to use, or 0 to choose one per
+ *                  64 requests (at most 16)
+ *
+ * @returns zero if every read succeeded, ERR_INVMSR if some failed (see the
+ *          error of each request), and some other negative number on error.
+ */
+int cpu_rdmsr_batch(struct msr_cpu_set_t* set, struct msr_request_t* requests, int count, int threads);
+
+/**
+ * @brief Closes all handles of the set and frees it
+ */
+void cpu_msr_close_all(struct msr_cpu_set_t* set);
+
+/**
+ * @brief Where \ref cpu_thermal_info_t came from
+ */
+typedef enum {
+	THERMAL_SOURCE_NONE = 0,	/*!< Nothing could be read */
+	THERMAL_SOURCE_MSR,	/*!< IA32_THERM_STATUS and IA32_PACKAGE_THERM_STATUS */
+	THERMAL_SOURCE_SYSFS,	/*!< Linux hwmon (coretemp, k10temp) and thermal_throttle */
+} cpu_thermal_source_t;
+
+/**
+ * @brief The thermal state of a core or of a package
+ *
+ * Fields that the source does not provide are -1 (CPU_INVALID_VALUE for
+ * the temperature). The *_log fields are sticky: they stay set from the
+ * first event until software clears them (e.g. the kernel's thermal
+ * interrupt handler), so they tell whether the event happened at all since.
+ */
+struct cpu_thermal_status_t {
+	/** Temperature in Celsius */
+	int temperature;
+	
+	/** The temperature at which thermal throttling starts (TjMax), Celsius */
+	int tjmax;
+	
+	/** 1 if thermally throttled right now */
+	int throttling;
+	
+	/** 1 if thermally throttled at some point (sticky) */
+	int throttle_log;
+	
+	/** 1 if PROCHOT# is asserted right now */
+	int prochot;
+	
+	/** 1 if PROCHOT# was asserted at some point (sticky) */
+	int prochot_log;
+	
+	/** 1 if the frequency is limited by a power or current limit right now */
+	int power_limit;
+	
+	/** 1 if a power or current limit applied at some point (sticky) */
+	int power_limit_log;
+	
+	/** Number of throttling events counted by the OS (sysfs only) */
+	long throttle_count;
+};
+
+/**
+ * @brief The thermal state of one logical CPU, its core and its package
+ */
+struct cpu_thermal_info_t {
+	/** The OS number of the CPU */
+	int cpu;
+	
+	/** The core the CPU belongs to */
+	struct cpu_thermal_status_t core;
+	
+	/** The package (socket) the CPU belongs to */
+	struct cpu_thermal_status_t package;
+	
+	/** Where the data came from */
+	cpu_thermal_source_t source;
+};
+
+/**
+ * @brief Reads the thermal state of a CPU from its MSRs
+ *
+ * Decodes IA32_THERM_STATUS (19Ch) and, where present,
+ * IA32_PACKAGE_THERM_STATUS (1B1h). The digital readouts are relative to
+ * TjMax, which is taken from IA32_TEMPERATURE_TARGET (1A2h), or 100 C on
+ * processors that lack it. Intel processors only.
+ *
+ * @param handle - the MSR driver of the CPU
+ * @param info - Output - the thermal state. Its cpu field is kept.
+ *
+ * @returns zero if successful, ERR_CPU_UNKN on non-Intel processors, and
+ *          some other negative number on error.
+ */
+int cpu_thermal_by_msr(struct msr_driver_t* handle, struct cpu_thermal_info_t* info);
+
+/**
+ * @brief Reads the thermal state of a CPU from the Linux sysfs
+ *
+ * Uses the coretemp (Intel) or k10temp (AMD) hwmon sensors and the
+ * thermal_throttle event counters, so it needs no MSR access. Whether the
+ * CPU is throttling right now is not reported there; the event counters
+ * stand in for the log bits.
+ *
+ * @param sysfs_root - where the sysfs is mounted, or NULL for "/sys"
+ * @param cpu - the OS number of the CPU
+ * @param info - Output - the thermal state
+ *
+ * @returns zero if successful, and ERR_NOT_IMP if there is nothing to read.
+ */
+int cpu_thermal_by_sysfs(const char* sysfs_root, int cpu, struct cpu_thermal_info_t* info);
+
+/**
+ * @brief Reads the thermal state of every online CPU
+ *
+ * Uses the MSRs of each CPU that has a handle in the set, and the sysfs for
+ * the others (or all, if set is NULL).
+ *
+ * @param set - the MSR handles, or NULL
+ * @param sysfs_root - where the sysfs is mounted, or NULL for "/sys"
+ * @param infos - Output - an array with room for max_cpus entries
+ * @param max_cpus - CPUs 0 to max_cpus - 1 are considered
+ *
+ * @returns the number of entries filled, or a negative number on error.
+ */
+int cpu_thermal_read_all(struct msr_cpu_set_t* set, const char* sysfs_root, struct cpu_thermal_info_t* infos, int max_cpus);
+
+/**
+ * @brief Returns the short name of a thermal source, e.g. "msr"
+ */
+const char* cpu_thermal_source_str(cpu_thermal_source_t source);
+
+/**
+ * @brief The RAPL (Running Average Power Limit) energy domains
+ */
+typedef enum {
+	ENERGY_DOMAIN_PACKAGE = 0,	/*!< The whole package (socket) */
+	ENERGY_DOMAIN_CORE,	/*!< The cores of a package (Intel PP0), or one core (AMD) */
+	ENERGY_DOMAIN_UNCORE,	/*!< The integrated graphics (Intel PP1) */
+	ENERGY_DOMAIN_DRAM,	/*!< The memory attached to a package */
+	ENERGY_DOMAIN_PSYS,	/*!< The whole platform (powercap only) */
+	NUM_ENERGY_DOMAINS,
+} cpu_energy_domain_t;
+
+/**
+ * @brief Where a \ref cpu_energy_sampler_t reads its counters
+ */
+typedef enum {
+	ENERGY_SOURCE_NONE = 0,	/*!< No counters */
+	ENERGY_SOURCE_MSR,	/*!< The RAPL MSRs (Intel 611h etc., AMD C001029Ah/Bh) */
+	ENERGY_SOURCE_POWERCAP,	/*!< The Linux powercap (intel-rapl) sysfs tree */
+} cpu_energy_source_t;
+
+/**
+ * @brief One energy counter's reading by \ref cpu_energy_sample
+ */
+struct cpu_energy_reading_t {
+	/** The package the counter belongs to, or -1 (psys) */
+	int package;
+	
+	/** The CPU whose core the counter measures (AMD per-core), or -1 */
+	int cpu;
+	
+	/** The domain */
+	cpu_energy_domain_t domain;
+	
+	/** 1 if the counter could be read this time */
+	int valid;
+	
+	/** Energy used over the window, in joules */
+	double joules;
+	
+	/** Average power over the window, in watts */
+	double watts;
+	
+	/** Energy used since the sampler was created, in joules */
+	double total_joules;
+	
+	/** Fraction of the window the package was throttled by a RAPL power
+	    limit (Intel MSR_PKG_PERF_STATUS), or -1 if unknown */
+	double throttled;
+};
+
+/**
+ * @brief Samples the RAPL energy counters
+ *
+ * The MSR counters are 32 bits wide, in units of 15 uJ to 61 uJ, so they
+ * wrap around after a few minutes at a few hundred watts; the sampler keeps
+ * the previous reading of each one and accounts for one wraparound between
+ * samples. Sample at least once a minute.
+ */
+struct cpu_energy_sampler_t;
+
+/**
+ * @brief Finds the energy counters and creates a sampler for them
+ *
+ * Uses the RAPL MSRs of the first CPU of every package (and, on AMD, of
+ * every core) if set has handles for them, and the powercap sysfs tree
+ * otherwise.
+ *
+ * @param set - the MSR handles, or NULL to use the powercap tree only
+ * @param sysfs_root - where the sysfs is mounted, or NULL for "/sys". A
+ *                     directory with the same layout can stand in for it
+ *                     in tests.
+ *
+ * @returns the sampler, or NULL if no counter was found (ERR_NOT_IMP).
+ */
+struct cpu_energy_sampler_t* cpu_energy_sampler_create(struct msr_cpu_set_t* set, const char* sysfs_root);
+
+/**
+ * @brief Returns the number of counters the sampler reads
+ */
+int cpu_energy_sampler_count(struct cpu_energy_sampler_t* sampler);
+
+/**
+ * @brief Returns where the sampler reads its counters
+ */
+cpu_energy_source_t cpu_energy_sampler_source(struct cpu_energy_sampler_t* sampler);
+
+/**
+ * @brief Reads all counters and reports the energy since the previous call
+ *
+ * The first call only takes the baseline; its joules and watts are zero.
+ *
+ * @param sampler - the sampler
+ * @param readings - Output - room for max_readings entries
+ * @param max_readings - the size of readings;
+ *                       \ref cpu_energy_sampler_count entries are needed
+ * @param window_seconds - Output - the time since the previous call, or 0.
+ *                         May be NULL.
+ *
+ * @returns the number of readings filled, or a negative number on error.
+ */
+int cpu_energy_sample(struct cpu_energy_sampler_t* sampler, struct cpu_energy_reading_t* readings, int max_readings, double* window_seconds);
+
+/**
+ * @brief Frees a sampler
+ */
+void cpu_energy_sampler_destroy(struct cpu_energy_sampler_t* sampler);
+
+/**
+ * @brief Returns the short name of an energy domain, e.g. "package"
+ */
+const char* cpu_energy_domain_str(cpu_energy_domain_t domain);
+
+/**
+ * @brief Returns the short name of an energy source, e.g. "powercap"
+ */
+const char* cpu_energy_source_str(cpu_energy_source_t source);
+
+#define MAX_TURBO_ENTRIES 32
+#define MAX_TURBO_PSTATES 8
+
+/**
+ * @brief The highest frequency for a group of active core counts
+ */
+struct cpu_turbo_entry_t {
+	/** The largest number of active cores the entry applies to */
+	int active_cores;
+	
+	/** The highest frequency with that many cores active, in MHz */
+	int mhz;
+};
+
+/**
+ * @brief The decoded turbo ratio limits of a processor
+ * @see cpu_turbo_table
+ */
+struct cpu_turbo_table_t {
+	/** Base (maximum non-turbo) frequency in MHz, or -1 */
+	int base_mhz;
+	
+	/** The reference clock the ratios multiply, in MHz, or -1 */
+	int bus_mhz;
+	
+	/** 1 if turbo is enabled, 0 if disabled (e.g. in the BIOS), -1 if unknown */
+	int turbo_enabled;
+	
+	/** Number of valid entries */
+	int num_entries;
+	
+	/** The frequency for each group of active core counts, in ascending order
+	    of active_cores. Entry i applies from entries[i - 1].active_cores + 1
+	    to entries[i].active_cores cores. */
+	struct cpu_turbo_entry_t entries[MAX_TURBO_ENTRIES];
+	
+	/** Number of enabled P-states (AMD only) */
+	int num_pstates;
+	
+	/** The frequency of each enabled P-state, P0 first, in MHz (AMD only) */
+	int pstate_mhz[MAX_TURBO_PSTATES];
+};
+
+/**
+ * @brief Reads the turbo frequency for each number of active cores
+ *
+ * On Intel processors, decodes MSR_TURBO_RATIO_LIMIT (1ADh), together with
+ * MSR_TURBO_RATIO_LIMIT1/2 (1AEh/1AFh), which hold either the core counts of
+ * the eight groups (Skylake-SP, Goldmont and later) or the ratios for 9 and
+ * more cores (Ivy Bridge-EP, Haswell-EP). The base frequency comes from
+ * MSR_PLATFORM_INFO (CEh), and the turbo switch from IA32_MISC_ENABLE.
+ *
+ * AMD processors (family 17h and later) publish no such table; the P-state
+ * MSRs (C0010064h and up) are decoded instead, and the single entry holds
+ * the P0 frequency for all cores. Boost can exceed it.
+ *
+ * @param handle - an MSR driver handle
+ * @param table - Output - the table
+ *
+ * @returns zero if successful, ERR_CPU_UNKN on other processors, and some
+ *          other negative number on error.
+ */
+int cpu_turbo_table(struct msr_driver_t* handle, struct cpu_turbo_table_t* table);
+
+/**
+ * @brief Measures the frequency with the given number of cores busy
+ *
+ * Starts one spinning thread on each of active_cores distinct physical
+ * cores and measures their busy frequency from APERF/MPERF (see
+ * \ref cpu_perf_delta), as a cross-check of \ref cpu_turbo_table. Power
+ * and thermal limits, and other load on the machine, can keep the result
+ * below the table. Linux only.
+ *
+ * @param set - MSR handles of the CPUs to use
+ * @param active_cores - the number of cores to load
+ * @param millis - how long to measure, after a 5 ms warm-up
+ * @param mhz - Output - the average busy frequency of the loaded cores
+ *
+ * @returns zero if successful, and some negative number on error.
+ */
+int cpu_turbo_measure(struct msr_cpu_set_t* set, int active_cores, int millis, double* mhz);
+
+/**
+ * @brief Where \ref cpu_perf_levels_t came from
+ */
+typedef enum {
+	PERF_LEVELS_SOURCE_NONE = 0,	/*!< Nothing could be read */
+	PERF_LEVELS_SOURCE_HWP,	/*!< IA32_HWP_CAPABILITIES (771h) */
+	PERF_LEVELS_SOURCE_CPPC,	/*!< The Linux acpi_cppc sysfs attributes */
+} cpu_perf_levels_source_t;
+
+/**
+ * @brief The performance levels a CPU can run at
+ *
+ * The levels are on an abstract scale, which is the same for all CPUs of a
+ * machine but not across machines (roughly 100 MHz per unit on most
+ * non-hybrid Intel processors). Unknown levels are -1.
+ */
+struct cpu_perf_levels_t {
+	/** The OS number of the CPU */
+	int cpu;
+	
+	/** The highest level, reachable with turbo. Preferred (favored) cores
+	    have a higher one than the others. */
+	int highest;
+	
+	/** The level the CPU sustains under the platform's constraints */
+	int guaranteed;
+	
+	/** The most energy-efficient level (CPPC: lowest_nonlinear_perf) */
+	int most_efficient;
+	
+	/** The lowest level */
+	int lowest;
+	
+	/** The highest level in MHz, where the source anchors the scale (CPPC
+	    nominal_freq), or -1 */
+	int highest_mhz;
+	
+	/** The position after \ref cpu_perf_levels_rank, 0 for the fastest;
+	    CPUs with equal levels share a rank */
+	int rank;
+	
+	/** Where the levels came from */
+	cpu_perf_levels_source_t source;
+};
+
+/**
+ * @brief Reads the HWP performance levels of a CPU
+ *
+ * Decodes IA32_HWP_CAPABILITIES, which Intel processors with Hardware
+ * P-states (CPUID.06H:EAX[7]) implement per CPU.
+ *
+ * @param handle - the MSR driver of the CPU
+ * @param levels - Output - the levels. Its cpu field is kept.
+ *
+ * @returns zero if successful, and some negative number on error.
+ */
+int cpu_perf_levels_by_msr(struct msr_driver_t* handle, struct cpu_perf_levels_t* levels);
+
+/**
+ * @brief Reads the ACPI CPPC performance levels of a CPU from the sysfs
+ *
+ * Uses /sys/devices/system/cpu/cpuN/acpi_cppc, which is available on Intel
+ * and AMD processors alike, without privileges.
+ *
+ * @param sysfs_root - where the sysfs is mounted, or NULL for "/sys"
+ * @param cpu - the OS number of the CPU
+ * @param levels - Output - the levels
+ *
+ * @returns zero if successful, and ERR_NOT_IMP if there is no CPPC data.
+ */
+int cpu_perf_levels_by_cppc(const char* sysfs_root, int cpu, struct cpu_perf_levels_t* levels);
+
+/**
+ * @brief Reads the performance levels of every CPU
+ *
+ * Uses the MSRs of each CPU that has a handle in the set, and ACPI CPPC for
+ * the others (or all, if set is NULL).
+ *
+ * @param set - the MSR handles, or NULL
+ * @param sysfs_root - where the sysfs is mounted, or NULL for "/sys"
+ * @param levels - Output - an array with room for max_cpus entries
+ * @param max_cpus - CPUs 0 to max_cpus - 1 are considered
+ *
+ * @returns the number of entries filled, or a negative number on error.
+ */
+int cpu_perf_levels_read_all(struct msr_cpu_set_t* set, const char* sysfs_root, struct cpu_perf_levels_t* levels, int max_cpus);
+
+/**
+ * @brief Sorts CPUs from the fastest to the slowest, and numbers them
+ *
+ * Orders by highest, then guaranteed level, both descending, and sets the
+ * rank of each entry.
+ */
+void cpu_perf_levels_rank(struct cpu_perf_levels_t* levels, int count);
+
+/**
+ * @brief Returns the short name of a performance level source, e.g. "hwp"
+ */
+const char* cpu_perf_levels_source_str(cpu_perf_levels_source_t source);
+
+/**
+ * @brief Reads the current frequency of every CPU, cheaply and repeatedly
+ *
+ * Unlike \ref cpu_clock_by_os, which parses all of /proc/cpuinfo (and makes
+ * the kernel query every CPU to generate it), the sampler opens the cpufreq
+ * scaling_cur_freq attribute of each online CPU once and rereads it with
+ * pread(), so a sample costs one small system call per CPU.
+ * Only implemented on Linux.
+ */
+struct cpu_freq_sampler_t;
+
+/**
+ * @brief Opens the frequency attributes of all online CPUs
+ *
+ * @param sysfs_root - where the sysfs is mounted, or NULL for "/sys"
+ *
+ * @returns the sampler, or NULL if no CPU has a cpufreq driver (ERR_NOT_IMP).
+ */
+struct cpu_freq_sampler_t* cpu_freq_sampler_create(const char* sysfs_root);
+
+/**
+ * @brief Returns the number of CPUs the sampler reads
+ */
+int cpu_freq_sampler_count(struct cpu_freq_sampler_t* sampler);
+
+/**
+ * @brief Returns the OS number of the CPU at an index of the samples, or -1
+ */
+int cpu_freq_sampler_cpu(struct cpu_freq_sampler_t* sampler, int index);
+
+/**
+ * @brief Reads the current frequency of every CPU
+ *
+ * @param sampler - the sampler
+ * @param mhz - Output - the frequencies in MHz, in the order of
+ *              \ref cpu_freq_sampler_cpu, or -1 where a read failed (e.g.
+ *              the CPU went offline)
+ * @param max_cpus - the size of mhz
+ *
+ * @returns the number of entries filled, or a negative number on error.
+ */
+int cpu_freq_sample(struct cpu_freq_sampler_t* sampler, double* mhz, int max_cpus);
+
+/**
+ * @brief Closes the attributes and frees a sampler
+ */
+void cpu_freq_sampler_destroy(struct cpu_freq_sampler_t* sampler);
+
+/**
+ * @brief The time a CPU spent in each state since boot, from /proc/stat
+ *
+ * All times are in USER_HZ ticks (sysconf(_SC_CLK_TCK), usually 1/100 s).
+ */
+struct cpu_times_t {
+	/** The OS number of the CPU */
+	int cpu;
+	
+	/** Running user code, at normal and at low (nice) priority */
+	uint64_t user, nice;
+	
+	/** Running the kernel */
+	uint64_t system;
+	
+	/** Idle, and idle with I/O pending */
+	uint64_t idle, iowait;
+	
+	/** Servicing hardware and software interrupts */
+	uint64_t irq, softirq;
+	
+	/** Stolen by the hypervisor for other virtual machines */
+	uint64_t steal;
+};
+
+/**
+ * @brief Reads the per-CPU times from /proc/stat, repeatedly
+ *
+ * Keeps /proc/stat open and rereads it with pread() into a buffer that is
+ * reused, so that polling it allocates nothing. Only implemented on Linux.
+ */
+struct cpu_times_reader_t;
+
+/**
+ * @brief Opens /proc/stat
+ *
+ * @param procfs_root - where the procfs is mounted, or NULL for "/proc"
+ *
+ * @returns the reader, or NULL on error (ERR_NOT_IMP if there is no
+ *          /proc/stat).
+ */
+struct cpu_times_reader_t* cpu_times_open(const char* procfs_root);
+
+/**
+ * @brief Reads the times of every online CPU
+ *
+ * @param reader - the reader
+ * @param times - Output - one entry per online CPU, in the order of the CPU
+ *                numbers. Offline CPUs are left out.
+ * @param max_cpus - the size of times
+ *
+ * @returns the number of entries filled, or a negative number on error.
+ */
+int cpu_times_read(struct cpu_times_reader_t* reader, struct cpu_times_t* times, int max_cpus);
+
+/**
+ * @brief Returns the fraction of time a CPU was busy between two readings
+ *
+ * Time waiting for I/O counts as idle.
+ *
+ * @returns the fraction between 0 and 1, or -1 if it cannot be told (no time
+ *          passed, or the readings are of different CPUs).
+ */
+double cpu_times_utilization(const struct cpu_times_t* before, const struct cpu_times_t* after);
+
+/**
+ * @brief Closes /proc/stat and frees a reader
+ */
+void cpu_times_close(struct cpu_times_reader_t* reader);
+
+/**
+ * @brief Returns the number of \ref cpu_times_t ticks per second (USER_HZ)
+ */
+int cpu_times_ticks_per_second(void);
+
+/** The highest CPU number \ref cpu_effective_t can list, plus one */
+#define MAX_EFFECTIVE_CPUS 1024
+
+/**
+ * @brief The CPUs this process can actually use
+ *
+ * total_logical_cpus counts the online CPUs of the machine. A process in a
+ * container usually gets far less: its affinity mask and its cgroup's
+ * cpuset limit the CPUs it may run on, and a CFS quota limits the CPU time
+ * it gets per period across all of them.
+ */
+struct cpu_effective_t {
+	/** The number of CPUs the process may run on */
+	int num_cpus;
+	
+	/** Their OS numbers, ascending: the intersection of the affinity mask
+	    and the cgroup cpuset */
+	int cpus[MAX_EFFECTIVE_CPUS];
+	
+	/** The CPU quota in CPUs (e.g. 2.5 for 250 ms per 100 ms period), the
+	    tightest of the cgroup and its ancestors, or -1 if unlimited */
+	double quota;
+	
+	/** The quota and its period in microseconds, or -1 if unlimited */
+	long quota_us, period_us;
+	
+	/** How many threads can run at once: num_cpus, or the quota rounded
+	    up if that is less. At least 1. */
+	int parallelism;
+	
+	/** The number of online CPUs of the machine */
+	int online_cpus;
+	
+	/** The cgroup version the limits were read from (1 or 2), or 0 */
+	int cgroup_version;
+};
+
+/**
+ * @brief Determines the CPUs this process can actually use
+ *
+ * Combines sched_getaffinity() with the cgroup v1 (cpu.cfs_quota_us,
+ * cpu.cfs_period_us, cpuset.cpus) or v2 (cpu.max, cpuset.cpus.effective)
+ * limits of the process, found through /proc/self/cgroup and
+ * /proc/self/mountinfo. On other systems than Linux, all CPUs are reported.
+ *
+ * @param proc_root - where the procfs is mounted, or NULL for "/proc"
+ * @param cgroup_root - NULL to find the cgroup mounts, or a directory that
+ *                      stands in for them (e.g. a test fixture). If
+ *                      proc_root has a self/mountinfo, its mount points are
+ *                      taken relative to this directory; otherwise it is a
+ *                      v2 hierarchy if it has a cgroup.controllers file,
+ *                      else one subdirectory per v1 controller ("cpu" or
+ *                      "cpu,cpuacct", and "cpuset"). The affinity mask is
+ *                      ignored then.
+ * @param eff - Output - the usable CPUs
+ *
+ * @returns zero if successful, and some negative number on error.
+ */
+int cpu_effective_cpus(const char* proc_root, const char* cgroup_root, struct cpu_effective_t* eff);
+
+/**
+ * @brief The CPU throttling and pressure counters of the process's cgroup
+ *
+ * Counters that are not available are -1. The cpu.stat counters are those
+ * of the cgroup the process is in; the pressure stall information (PSI) is
+ * that of the cgroup too with cgroup v2, and of the whole system otherwise.
+ */
+struct cpu_pressure_t {
+	/** When the counters were read, in microseconds of a monotonic clock */
+	uint64_t timestamp_us;
+	
+	/** CPU time used by the cgroup (cgroup v2 only) */
+	int64_t usage_us;
+	
+	/** CFS enforcement periods that have elapsed, and those in which the
+	    cgroup ran out of quota */
+	int64_t nr_periods, nr_throttled;
+	
+	/** Total time the cgroup was throttled */
+	int64_t throttled_us;
+	
+	/** Percentage of time some runnable tasks were stalled waiting for a
+	    CPU, averaged over 10 s, 60 s and 300 s, and the total stall time */
+	double some_avg10, some_avg60, some_avg300;
+	int64_t some_total_us;
+	
+	/** The same for all non-idle tasks stalled at once (cgroup v2 only) */
+	double full_avg10, full_avg60, full_avg300;
+	int64_t full_total_us;
+};
+
+/**
+ * @brief Rates between two \ref cpu_pressure_t readings
+ *
+ * All are -1 where a counter is missing from either reading.
+ */
+struct cpu_pressure_rates_t {
+	/** The time between the readings */
+	double seconds;
+	
+	/** CPU time used per second, i.e. the number of CPUs kept busy */
+	double usage;
+	
+	/** The fraction of the time the cgroup was throttled */
+	double throttled;
+	
+	/** The fraction of CFS periods in which the cgroup was throttled */
+	double throttled_periods;
+	
+	/** The fraction of the time some, or all, tasks were stalled */
+	double some, full;
+};
+
+/**
+ * @brief Reads the cpu.stat and PSI counters of the process's cgroup,
+ *        repeatedly
+ *
+ * Keeps the files open and rereads them with pread(). Only implemented on
+ * Linux.
+ */
+struct cpu_pressure_reader_t;
+
+/**
+ * @brief Opens cpu.stat and cpu.pressure, or /proc/pressure/cpu
+ *
+ * @param proc_root - where the procfs is mounted, or NULL for "/proc"
+ * @param cgroup_root - NULL to find the cgroup mounts, or a directory that
+ *                      stands in for them; see \ref cpu_effective_cpus
+ *
+ * @returns the reader, or NULL if neither file exists (ERR_NOT_IMP).
+ */
+struct cpu_pressure_reader_t* cpu_pressure_open(const char* proc_root, const char* cgroup_root);
+
+/**
+ * @brief Reads the counters
+ *
+ * @returns zero if successful, and some negative number on error.
+ */
+int cpu_pressure_read(struct cpu_pressure_reader_t* reader, struct cpu_pressure_t* pressure);
+
+/**
+ * @brief Computes the rates between two readings
+ *
+ * @returns zero if successful, and ERR_HANDLE if no time passed between them.
+ */
+int cpu_pressure_rates(const struct cpu_pressure_t* before, const struct cpu_pressure_t* after, struct cpu_pressure_rates_t* rates);
+
+/**
+ * @brief Closes the files and frees a reader
+ */
+void cpu_pressure_close(struct cpu_pressure_reader_t* reader);
+
+/**
+ * @brief One reading of the APERF/MPERF counters and the TSC
+ * @see cpu_read_perf_sample
+ */
+struct cpu_perf_sample_t {
+	/** IA32_APERF: core clocks while the core was active (C0) */
+	uint64_t aperf;
+	
+	/** IA32_MPERF: TSC-rate clocks while the core was active (C0) */
+	uint64_t mperf;
+	
+	/** The TSC */
+	uint64_t tsc;
+	
+	/** The OS monotonic clock, in nanoseconds */
+	uint64_t ns;
+};
+
+/**
+ * @brief What happened between two \ref cpu_perf_sample_t readings
+ * @see cpu_perf_delta
+ */
+struct cpu_perf_delta_t {
+	/** Average frequency while the core was active, in MHz, i.e. the TSC
+	    rate times dAPERF / dMPERF. Zero if the core was idle throughout. */
+	double effective_mhz;
+	
+	/** Average frequency over the whole window, idle time included, in MHz */
+	double average_mhz;
+	
+	/** The TSC rate over the window, in MHz */
+	double tsc_mhz;
+	
+	/** Fraction of the window the core was active, 0 to 1 */
+	double busy;
+	
+	/** Length of the window, in nanoseconds */
+	uint64_t elapsed_ns;
+};
+
+/**
+ * @brief Reads APERF, MPERF and the TSC together
+ *
+ * The counters are read back to back, so they cover the same window to
+ * within a few microseconds. This does not wait; compare two samples with
+ * \ref cpu_perf_delta.
+ *
+ * @param handle - a handle to the MSR driver of the CPU to sample
+ * @param sample - Output - the readings
+ *
+ * @returns zero if successful, and some negative number on error.
+ */
+int cpu_read_perf_sample(struct msr_driver_t* handle, struct cpu_perf_sample_t* sample);
+
+/**
+ * @brief Computes the frequency and utilization between two samples
+ *
+ * @param prev - the earlier sample
+ * @param cur - the later sample, of the same CPU
+ * @param delta - Output - the results
+ *
+ * @returns zero if successful, ERR_BADFMT if the samples are not in order.
+ */
+int cpu_perf_delta(const struct cpu_perf_sample_t* prev, const struct cpu_perf_sample_t* cur, struct cpu_perf_delta_t* delta);
+
 #ifdef __cplusplus
 }; /* extern "C" */
 #endif
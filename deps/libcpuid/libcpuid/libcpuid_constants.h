@@ -34,11 +34,15 @@
 
 #define VENDOR_STR_MAX		16
 #define BRAND_STR_MAX		64
-#define CPU_FLAGS_MAX		128
+#define CPU_FLAGS_MAX		192
 #define MAX_CPUID_LEVEL		32
 #define MAX_EXT_CPUID_LEVEL	32
-#define MAX_INTELFN4_LEVEL	4
+#define MAX_INTELFN4_LEVEL	8
+#define MAX_INTELFN7_LEVEL	4
 #define MAX_INTELFN11_LEVEL	4
+#define MAX_INTELFN13_LEVEL	19
+#define MAX_INTELFN31_LEVEL	8
+#define MAX_AMDFN8000001D_LEVEL	8
 #define CPU_HINTS_MAX		16
 
 #endif /* __LIBCPUID_CONSTANTS_H__ */
@@ -31,6 +31,11 @@
 #include <ctype.h>
 #include "libcpuid.h"
 #include "libcpuid_util.h"
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
 
 int _current_verboselevel;
 
@@ -170,13 +175,58 @@ int match_pattern(const char* s, const char* p)
 	return 0;
 }
 
+int parse_cpu_list(const char* list, void (*fn)(int, void*), void* arg)
+{
+	const char* p = list;
+	char* end;
+	long first, last, cpu;
+	int count = 0;
+	while (*p) {
+		first = strtol(p, &end, 10);
+		if (end == p) break;
+		last = first;
+		p = end;
+		if (*p == '-') {
+			last = strtol(p + 1, &end, 10);
+			p = end;
+		}
+		for (cpu = first; cpu <= last; cpu++, count++)
+			fn((int) cpu, arg);
+		while (*p == ',' || *p == ' ' || *p == '\n') p++;
+	}
+	return count;
+}
+
+static struct cpu_id_t cached_id;
+
+static void init_cached_cpuid(void)
+{
+	if (cpu_identify(NULL, &cached_id))
+		memset(&cached_id, 0, sizeof(cached_id));
+}
+
+/* The identification is done exactly once, even if several threads ask for
+   it at the same time */
+#ifdef _WIN32
+static INIT_ONCE cached_id_once = INIT_ONCE_STATIC_INIT;
+
+static BOOL CALLBACK init_cached_cpuid_once(PINIT_ONCE once, PVOID param, PVOID* context)
+{
+	init_cached_cpuid();
+	return TRUE;
+}
+
+struct cpu_id_t* get_cached_cpuid(void)
+{
+	InitOnceExecuteOnce(&cached_id_once, init_cached_cpuid_once, NULL, NULL);
+	return &cached_id;
+}
+#else
+static pthread_once_t cached_id_once = PTHREAD_ONCE_INIT;
+
 struct cpu_id_t* get_cached_cpuid(void)
 {
-	static int initialized = 0;
-	static struct cpu_id_t id;
-	if (initialized) return &id;
-	if (cpu_identify(NULL, &id))
-		memset(&id, 0, sizeof(id));
-	initialized = 1;
-	return &id;
+	pthread_once(&cached_id_once, init_cached_cpuid);
+	return &cached_id;
 }
+#endif /* _WIN32 */
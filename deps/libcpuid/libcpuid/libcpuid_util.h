@@ -70,6 +70,13 @@ void generic_get_cpu_list(const struct match_entry_t* matchtable, int count,
  */
 int match_pattern(const char* haystack, const char* pattern);
 
+/*
+ * Calls fn(cpu, arg) for each CPU in a Linux CPU list such as "0-3,8,10-11"
+ * (the format of /sys/devices/system/cpu/online and cpuset.cpus).
+ * Return val: the number of CPUs listed.
+ */
+int parse_cpu_list(const char* list, void (*fn)(int, void*), void* arg);
+
 /*
  * Gets an initialized cpu_id_t. It is cached, so that internal libcpuid
  * machinery doesn't need to issue cpu_identify more than once.
@@ -81,6 +88,11 @@ struct cpu_id_t* get_cached_cpuid(void);
  */
 int set_error(cpu_error_t err);
 
+/*
+ * Returns the last errno set on this thread
+ */
+int get_error(void);
+
 extern libcpuid_warn_fn_t _warn_fun;
 extern int _current_verboselevel;
 
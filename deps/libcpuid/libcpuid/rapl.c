@@ -0,0 +1,411 @@
+/*
+ * Copyright 2026  cpuid-node contributors
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "libcpuid.h"
+#include "libcpuid_util.h"
+#include "rdtsc.h"
+
+#define MSR_RAPL_POWER_UNIT		0x606
+#define MSR_PKG_ENERGY_STATUS		0x611
+#define MSR_PKG_PERF_STATUS		0x613
+#define MSR_DRAM_ENERGY_STATUS		0x619
+#define MSR_PP0_ENERGY_STATUS		0x639
+#define MSR_PP1_ENERGY_STATUS		0x641
+
+#define MSR_AMD_RAPL_POWER_UNIT		0xc0010299
+#define MSR_AMD_CORE_ENERGY_STATUS	0xc001029a
+#define MSR_AMD_PKG_ENERGY_STATUS	0xc001029b
+
+#define MAX_POWERCAP_ZONES 64
+#define COUNTER_32BIT ((uint64_t) 1 << 32)
+
+/* One energy counter: an MSR of one CPU, or a powercap energy_uj file */
+struct energy_counter_t {
+	int package;
+	int cpu;
+	cpu_energy_domain_t domain;
+	struct msr_driver_t* handle;
+	uint32_t msr;
+	char path[256];
+	double unit;		/* joules per count */
+	uint64_t range;		/* the counter wraps around at this value */
+	uint64_t last;
+	double total;
+	/* Intel MSR_PKG_PERF_STATUS: time throttled by RAPL limits */
+	uint32_t perf_msr;
+	double time_unit;	/* seconds per count */
+	uint64_t last_perf;
+};
+
+struct cpu_energy_sampler_t {
+	cpu_energy_source_t source;
+	int count, capacity;
+	struct energy_counter_t* counters;
+	uint64_t last_ns;
+	int primed;
+};
+
+static int read_file_u64(const char* path, uint64_t* value)
+{
+	FILE* f = fopen(path, "rt");
+	unsigned long long v;
+	int ok;
+	if (!f) return 0;
+	ok = fscanf(f, "%llu", &v) == 1;
+	fclose(f);
+	if (ok) *value = (uint64_t) v;
+	return ok;
+}
+
+static int read_file_line(const char* path, char* buf, int size)
+{
+	FILE* f = fopen(path, "rt");
+	char* nl;
+	if (!f) return 0;
+	if (!fgets(buf, size, f))
+		buf[0] = 0;
+	fclose(f);
+	if ((nl = strchr(buf, '\n')) != NULL)
+		*nl = 0;
+	return buf[0] != 0;
+}
+
+static struct energy_counter_t* add_counter(struct cpu_energy_sampler_t* sampler, int package, int cpu, cpu_energy_domain_t domain)
+{
+	struct energy_counter_t* counters;
+	struct energy_counter_t* counter;
+	if (sampler->count == sampler->capacity) {
+		sampler->capacity = sampler->capacity ? sampler->capacity * 2 : 8;
+		counters = (struct energy_counter_t*) realloc(sampler->counters, sampler->capacity * sizeof(struct energy_counter_t));
+		if (!counters) return NULL;
+		sampler->counters = counters;
+	}
+	counter = &sampler->counters[sampler->count++];
+	memset(counter, 0, sizeof(struct energy_counter_t));
+	counter->package = package;
+	counter->cpu = cpu;
+	counter->domain = domain;
+	return counter;
+}
+
+/* Adds an MSR counter if it can be read and is not stuck at zero */
+static int add_msr_counter(struct cpu_energy_sampler_t* sampler, struct msr_driver_t* handle,
+                           int package, int cpu, cpu_energy_domain_t domain, uint32_t msr, double unit)
+{
+	struct energy_counter_t* counter;
+	uint64_t value;
+	if (cpu_rdmsr(handle, msr, &value) != 0 || (value & 0xffffffff) == 0)
+		return 0;
+	counter = add_counter(sampler, package, cpu, domain);
+	if (!counter) return -1;
+	counter->handle = handle;
+	counter->msr = msr;
+	counter->unit = unit;
+	counter->range = COUNTER_32BIT;
+	return 1;
+}
+
+/* Returns a topology id of a CPU, or -1 if the sysfs does not have it */
+static long cpu_topology_id(const char* sysfs_root, int cpu, const char* name)
+{
+	char path[256];
+	uint64_t value;
+	snprintf(path, sizeof(path), "%s/devices/system/cpu/cpu%d/topology/%s", sysfs_root, cpu, name);
+	return read_file_u64(path, &value) ? (long) value : -1;
+}
+
+static long cpu_package_id(const char* sysfs_root, int cpu)
+{
+	long package = cpu_topology_id(sysfs_root, cpu, "physical_package_id");
+	return package < 0 ? 0 : package;
+}
+
+static int discover_msr_counters(struct cpu_energy_sampler_t* sampler, struct msr_cpu_set_t* set, const char* sysfs_root)
+{
+	struct cpu_id_t* id = get_cached_cpuid();
+	struct msr_driver_t* handle;
+	uint64_t units, perf;
+	double energy_unit, time_unit;
+	int cpu, other, size, seen_package, seen_core, amd;
+	long package, core;
+	
+	if (!id || !set || !id->flags[CPU_FEATURE_MSR])
+		return 0;
+	amd = id->vendor == VENDOR_AMD && id->ext_family >= 0x17;
+	if (id->vendor != VENDOR_INTEL && !amd)
+		return 0;
+	size = cpu_msr_set_size(set);
+	for (cpu = 0; cpu < size; cpu++) {
+		if (!(handle = cpu_msr_set_handle(set, cpu)))
+			continue;
+		if (cpu_rdmsr(handle, amd ? MSR_AMD_RAPL_POWER_UNIT : MSR_RAPL_POWER_UNIT, &units) != 0)
+			return 0;
+		/* Energy in 1/2^ESU J (bits 12:8), time in 1/2^TU s (bits 19:16) */
+		energy_unit = 1.0 / (double) (1 << ((units >> 8) & 0x1f));
+		time_unit = 1.0 / (double) (1 << ((units >> 16) & 0xf));
+		package = cpu_package_id(sysfs_root, cpu);
+		core = cpu_topology_id(sysfs_root, cpu, "core_id");
+		/* The first CPU of each package (and, on AMD, of each core) reads
+		   the counters for all of it */
+		seen_package = seen_core = 0;
+		for (other = 0; other < cpu; other++) {
+			if (!cpu_msr_set_handle(set, other) || cpu_package_id(sysfs_root, other) != package)
+				continue;
+			seen_package = 1;
+			if (core < 0 || cpu_topology_id(sysfs_root, other, "core_id") == core)
+				seen_core = 1;
+		}
+		if (amd) {
+			if (!seen_package && add_msr_counter(sampler, handle, (int) package, -1, ENERGY_DOMAIN_PACKAGE, MSR_AMD_PKG_ENERGY_STATUS, energy_unit) < 0)
+				return -1;
+			if (!seen_core && add_msr_counter(sampler, handle, (int) package, cpu, ENERGY_DOMAIN_CORE, MSR_AMD_CORE_ENERGY_STATUS, energy_unit) < 0)
+				return -1;
+			continue;
+		}
+		if (seen_package)
+			continue;
+		switch (add_msr_counter(sampler, handle, (int) package, -1, ENERGY_DOMAIN_PACKAGE, MSR_PKG_ENERGY_STATUS, energy_unit)) {
+			case -1: return -1;
+			case 1:
+				if (cpu_rdmsr(handle, MSR_PKG_PERF_STATUS, &perf) == 0) {
+					sampler->counters[sampler->count - 1].perf_msr = MSR_PKG_PERF_STATUS;
+					sampler->counters[sampler->count - 1].time_unit = time_unit;
+				}
+				break;
+		}
+		if (add_msr_counter(sampler, handle, (int) package, -1, ENERGY_DOMAIN_CORE, MSR_PP0_ENERGY_STATUS, energy_unit) < 0 ||
+		    add_msr_counter(sampler, handle, (int) package, -1, ENERGY_DOMAIN_UNCORE, MSR_PP1_ENERGY_STATUS, energy_unit) < 0 ||
+		    add_msr_counter(sampler, handle, (int) package, -1, ENERGY_DOMAIN_DRAM, MSR_DRAM_ENERGY_STATUS, energy_unit) < 0)
+			return -1;
+	}
+	return sampler->count;
+}
+
+static cpu_energy_domain_t powercap_domain(const char* name, int* package)
+{
+	if (sscanf(name, "package-%d", package) == 1)
+		return ENERGY_DOMAIN_PACKAGE;
+	if (!strcmp(name, "core")) return ENERGY_DOMAIN_CORE;
+	if (!strcmp(name, "uncore")) return ENERGY_DOMAIN_UNCORE;
+	if (!strcmp(name, "dram")) return ENERGY_DOMAIN_DRAM;
+	if (!strcmp(name, "psys")) return ENERGY_DOMAIN_PSYS;
+	return NUM_ENERGY_DOMAINS;
+}
+
+static int add_powercap_zone(struct cpu_energy_sampler_t* sampler, const char* zone, int* package)
+{
+	char path[256], name[64];
+	struct energy_counter_t* counter;
+	cpu_energy_domain_t domain;
+	uint64_t range, value;
+	
+	snprintf(path, sizeof(path), "%s/name", zone);
+	if (!read_file_line(path, name, sizeof(name)))
+		return 0;
+	domain = powercap_domain(name, package);
+	if (domain == NUM_ENERGY_DOMAINS)
+		return 0;
+	snprintf(path, sizeof(path), "%s/max_energy_range_uj", zone);
+	if (!read_file_u64(path, &range))
+		return 0;
+	snprintf(path, sizeof(path), "%s/energy_uj", zone);
+	if (!read_file_u64(path, &value))
+		return 0;
+	counter = add_counter(sampler, domain == ENERGY_DOMAIN_PSYS ? -1 : *package, -1, domain);
+	if (!counter) return -1;
+	snprintf(counter->path, sizeof(counter->path), "%s", path);
+	counter->unit = 1e-6;
+	counter->range = range + 1;
+	return 1;
+}
+
+/* intel-rapl:P is a package (or psys) zone, intel-rapl:P:S its subzones.
+   AMD processors are exposed through the same driver */
+static int discover_powercap_counters(struct cpu_energy_sampler_t* sampler, const char* sysfs_root)
+{
+	char zone[256];
+	int p, s, package;
+	for (p = 0; p < MAX_POWERCAP_ZONES; p++) {
+		package = 0;
+		snprintf(zone, sizeof(zone), "%s/class/powercap/intel-rapl:%d", sysfs_root, p);
+		if (add_powercap_zone(sampler, zone, &package) < 0)
+			return -1;
+		for (s = 0; s < MAX_POWERCAP_ZONES; s++) {
+			snprintf(zone, sizeof(zone), "%s/class/powercap/intel-rapl:%d:%d", sysfs_root, p, s);
+			if (add_powercap_zone(sampler, zone, &package) < 0)
+				return -1;
+		}
+	}
+	return sampler->count;
+}
+
+static int read_counter(struct energy_counter_t* counter, uint64_t* value)
+{
+	if (counter->handle) {
+		if (cpu_rdmsr(counter->handle, counter->msr, value) != 0)
+			return 0;
+		*value &= 0xffffffff;
+		return 1;
+	}
+	return read_file_u64(counter->path, value);
+}
+
+/* The counters only ever go up, so a smaller reading means one wraparound;
+   sampling at least every few minutes keeps that unambiguous */
+static uint64_t counter_delta(uint64_t last, uint64_t now, uint64_t range)
+{
+	return now >= last ? now - last : range - last + now;
+}
+
+struct cpu_energy_sampler_t* cpu_energy_sampler_create(struct msr_cpu_set_t* set, const char* sysfs_root)
+{
+	struct cpu_energy_sampler_t* sampler;
+	int found;
+	
+	if (!sysfs_root)
+		sysfs_root = "/sys";
+	sampler = (struct cpu_energy_sampler_t*) calloc(1, sizeof(struct cpu_energy_sampler_t));
+	if (!sampler) {
+		set_error(ERR_NO_MEM);
+		return NULL;
+	}
+	found = discover_msr_counters(sampler, set, sysfs_root);
+	if (found > 0) {
+		sampler->source = ENERGY_SOURCE_MSR;
+	} else if (found == 0) {
+		sampler->count = 0;
+		found = discover_powercap_counters(sampler, sysfs_root);
+		sampler->source = ENERGY_SOURCE_POWERCAP;
+	}
+	if (found <= 0) {
+		cpu_energy_sampler_destroy(sampler);
+		set_error(found < 0 ? ERR_NO_MEM : ERR_NOT_IMP);
+		return NULL;
+	}
+	set_error(ERR_OK);
+	return sampler;
+}
+
+int cpu_energy_sampler_count(struct cpu_energy_sampler_t* sampler)
+{
+	return sampler ? sampler->count : 0;
+}
+
+cpu_energy_source_t cpu_energy_sampler_source(struct cpu_energy_sampler_t* sampler)
+{
+	return sampler ? sampler->source : ENERGY_SOURCE_NONE;
+}
+
+int cpu_energy_sample(struct cpu_energy_sampler_t* sampler, struct cpu_energy_reading_t* readings, int max_readings, double* window_seconds)
+{
+	struct energy_counter_t* counter;
+	struct cpu_energy_reading_t* reading;
+	uint64_t now, value, perf;
+	double seconds = 0, joules;
+	int i, n = 0;
+	
+	if (!sampler || (!readings && max_readings > 0))
+		return set_error(ERR_HANDLE);
+	sys_monotonic_clock_ns(&now);
+	if (sampler->primed && now > sampler->last_ns)
+		seconds = (double) (now - sampler->last_ns) / 1e9;
+	for (i = 0; i < sampler->count; i++) {
+		counter = &sampler->counters[i];
+		if (i < max_readings) {
+			reading = &readings[n++];
+			memset(reading, 0, sizeof(struct cpu_energy_reading_t));
+			reading->package = counter->package;
+			reading->cpu = counter->cpu;
+			reading->domain = counter->domain;
+			reading->throttled = -1;
+		} else {
+			reading = NULL;
+		}
+		if (!read_counter(counter, &value)) {
+			if (reading) reading->valid = 0;
+			continue;
+		}
+		if (sampler->primed) {
+			joules = (double) counter_delta(counter->last, value, counter->range) * counter->unit;
+			counter->total += joules;
+			if (reading) {
+				reading->joules = joules;
+				reading->watts = seconds > 0 ? joules / seconds : 0;
+			}
+		}
+		counter->last = value;
+		if (reading) {
+			reading->valid = 1;
+			reading->total_joules = counter->total;
+		}
+		if (counter->perf_msr && cpu_rdmsr(counter->handle, counter->perf_msr, &perf) == 0) {
+			perf &= 0xffffffff;
+			if (sampler->primed && reading && seconds > 0)
+				reading->throttled = (double) counter_delta(counter->last_perf, perf, COUNTER_32BIT) * counter->time_unit / seconds;
+			counter->last_perf = perf;
+		}
+	}
+	sampler->last_ns = now;
+	sampler->primed = 1;
+	if (window_seconds)
+		*window_seconds = seconds;
+	set_error(ERR_OK);
+	return n;
+}
+
+void cpu_energy_sampler_destroy(struct cpu_energy_sampler_t* sampler)
+{
+	if (!sampler) return;
+	free(sampler->counters);
+	free(sampler);
+}
+
+const char* cpu_energy_domain_str(cpu_energy_domain_t domain)
+{
+	const struct { cpu_energy_domain_t domain; const char* name; }
+	matchtable[] = {
+		{ ENERGY_DOMAIN_PACKAGE, "package" },
+		{ ENERGY_DOMAIN_CORE, "core" },
+		{ ENERGY_DOMAIN_UNCORE, "uncore" },
+		{ ENERGY_DOMAIN_DRAM, "dram" },
+		{ ENERGY_DOMAIN_PSYS, "psys" },
+	};
+	unsigned i;
+	for (i = 0; i < COUNT_OF(matchtable); i++)
+		if (matchtable[i].domain == domain)
+			return matchtable[i].name;
+	return "";
+}
+
+const char* cpu_energy_source_str(cpu_energy_source_t source)
+{
+	switch (source) {
+		case ENERGY_SOURCE_MSR: return "msr";
+		case ENERGY_SOURCE_POWERCAP: return "powercap";
+		default: return "none";
+	}
+}
@@ -24,13 +24,26 @@
  * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 #define _XOPEN_SOURCE 500
+/* MSR indices such as AMD's 0xC001xxxx are used as file offsets into
+   /dev/cpu/N/msr, so off_t must hold any 32-bit index */
+#define _FILE_OFFSET_BITS 64
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "libcpuid.h"
 #include "asm-bits.h"
 #include "libcpuid_util.h"
 #include "rdtsc.h"
 
+/* The last reading of a performance counter, for cpu_msrinfo() */
+struct perfmsr_state_t {
+	uint64_t value;
+	uint64_t clock;
+};
+
+#define MSR_MPERF 0xe7
+#define MSR_APERF 0xe8
+
 #ifndef _WIN32
 #  ifdef __APPLE__
 /* On Darwin, we still do not support RDMSR, so supply dummy struct
@@ -42,7 +55,13 @@ struct msr_driver_t* cpu_msr_driver_open(void)
 	return NULL;
 }
 
-int cpu_rdmsr(struct msr_driver_t* driver, int msr_index, uint64_t* result)
+struct msr_driver_t* cpu_msr_driver_open_core(unsigned core_num)
+{
+	set_error(ERR_NOT_IMP);
+	return NULL;
+}
+
+int cpu_rdmsr(struct msr_driver_t* driver, uint32_t msr_index, uint64_t* result)
 {
 	return set_error(ERR_NOT_IMP);
 }
@@ -65,35 +84,58 @@ int cpu_msrinfo(struct msr_driver_t* driver, cpu_msrinfo_request_t which)
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <errno.h>
-struct msr_driver_t { int fd; };
+#include <pthread.h>
+struct msr_driver_t {
+	int fd;
+	struct perfmsr_state_t mperf, aperf;
+};
 static int rdmsr_supported(void);
+static void perfmsr_prime(struct msr_driver_t* handle);
 struct msr_driver_t* cpu_msr_driver_open(void)
+{
+	return cpu_msr_driver_open_core(0);
+}
+
+struct msr_driver_t* cpu_msr_driver_open_core(unsigned core_num)
 {
 	struct msr_driver_t* handle;
+	char path[32];
+	int fd;
 	if (!rdmsr_supported()) {
 		set_error(ERR_NO_RDMSR);
 		return NULL;
 	}
-		int fd = open("/dev/cpu/0/msr", O_RDONLY);
+	snprintf(path, sizeof(path), "/dev/cpu/%u/msr", core_num);
+	fd = open(path, O_RDONLY);
 	if (fd < 0) {
 		if (errno == EIO) {
 			set_error(ERR_NO_RDMSR);
 			return NULL;
 		}
+		if (errno == EACCES || errno == EPERM) {
+			set_error(ERR_NO_PERMS);
+			return NULL;
+		}
 		set_error(ERR_NO_DRIVER);
 		return NULL;
 	}
-	handle = (struct msr_driver_t*) malloc(sizeof(struct msr_driver_t));
+	handle = (struct msr_driver_t*) calloc(1, sizeof(struct msr_driver_t));
+	if (!handle) {
+		close(fd);
+		set_error(ERR_NO_MEM);
+		return NULL;
+	}
 	handle->fd = fd;
+	perfmsr_prime(handle);
 	return handle;
 }
-int cpu_rdmsr(struct msr_driver_t* driver, int msr_index, uint64_t* result)
+int cpu_rdmsr(struct msr_driver_t* driver, uint32_t msr_index, uint64_t* result)
 {
 	ssize_t ret;
 
 	if (!driver || driver->fd < 0)
 		return set_error(ERR_HANDLE);
-	ret = pread(driver->fd, result, 8, msr_index);
+	ret = pread(driver->fd, result, 8, (off_t) (uint32_t) msr_index);
 	if (ret != 8)
 		return set_error(ERR_INVMSR);
 	return 0;
@@ -107,6 +149,168 @@ int cpu_msr_driver_close(struct msr_driver_t* drv)
 	}
 	return 0;
 }
+
+struct msr_cpu_set_t {
+	int num_cpus;
+	struct msr_driver_t** handles;
+};
+
+static void note_max_cpu(int cpu, void* arg)
+{
+	int* num_cpus = (int*) arg;
+	if (cpu >= *num_cpus)
+		*num_cpus = cpu + 1;
+}
+
+static void open_listed_cpu(int cpu, void* arg)
+{
+	struct msr_cpu_set_t* set = (struct msr_cpu_set_t*) arg;
+	if (cpu < set->num_cpus && !set->handles[cpu])
+		set->handles[cpu] = cpu_msr_driver_open_core((unsigned) cpu);
+}
+
+struct msr_cpu_set_t* cpu_msr_open_all(void)
+{
+	struct msr_cpu_set_t* set;
+	char online[4096];
+	FILE* f;
+	int i, opened = 0, error = ERR_NO_DRIVER;
+	
+	if (!rdmsr_supported()) {
+		set_error(ERR_NO_RDMSR);
+		return NULL;
+	}
+	online[0] = 0;
+	f = fopen("/sys/devices/system/cpu/online", "rt");
+	if (f) {
+		if (!fgets(online, sizeof(online), f))
+			online[0] = 0;
+		fclose(f);
+	}
+	if (!online[0])
+		snprintf(online, sizeof(online), "0-%ld", sysconf(_SC_NPROCESSORS_CONF) - 1);
+	
+	set = (struct msr_cpu_set_t*) calloc(1, sizeof(struct msr_cpu_set_t));
+	if (!set) {
+		set_error(ERR_NO_MEM);
+		return NULL;
+	}
+	parse_cpu_list(online, note_max_cpu, &set->num_cpus);
+	set->handles = (struct msr_driver_t**) calloc(set->num_cpus > 0 ? set->num_cpus : 1, sizeof(struct msr_driver_t*));
+	if (!set->handles) {
+		free(set);
+		set_error(ERR_NO_MEM);
+		return NULL;
+	}
+	parse_cpu_list(online, open_listed_cpu, set);
+	for (i = 0; i < set->num_cpus; i++) {
+		if (set->handles[i])
+			opened++;
+	}
+	/* Keep the error of the failed opens if none succeeded */
+	if (opened == 0) {
+		error = get_error();
+		cpu_msr_close_all(set);
+		set_error(error < 0 ? error : ERR_NO_DRIVER);
+		return NULL;
+	}
+	set_error(ERR_OK);
+	return set;
+}
+
+int cpu_msr_set_size(struct msr_cpu_set_t* set)
+{
+	return set ? set->num_cpus : 0;
+}
+
+struct msr_driver_t* cpu_msr_set_handle(struct msr_cpu_set_t* set, int cpu)
+{
+	if (!set || cpu < 0 || cpu >= set->num_cpus)
+		return NULL;
+	return set->handles[cpu];
+}
+
+struct msr_batch_part_t {
+	struct msr_cpu_set_t* set;
+	struct msr_request_t* requests;
+	int count, part, num_parts;
+};
+
+/* Reads the requests of the CPUs that belong to this part */
+static void* read_batch_part(void* arg)
+{
+	struct msr_batch_part_t* part = (struct msr_batch_part_t*) arg;
+	struct msr_request_t* req;
+	struct msr_driver_t* handle;
+	int i;
+	for (i = 0; i < part->count; i++) {
+		req = &part->requests[i];
+		if (req->cpu < 0 || req->cpu % part->num_parts != part->part)
+			continue;
+		handle = cpu_msr_set_handle(part->set, req->cpu);
+		req->value = 0;
+		req->error = handle ? cpu_rdmsr(handle, req->msr, &req->value) : ERR_HANDLE;
+	}
+	return NULL;
+}
+
+#define MAX_BATCH_THREADS 16
+#define MIN_READS_PER_THREAD 64
+
+int cpu_rdmsr_batch(struct msr_cpu_set_t* set, struct msr_request_t* requests, int count, int threads)
+{
+	struct msr_batch_part_t parts[MAX_BATCH_THREADS];
+	pthread_t tids[MAX_BATCH_THREADS];
+	int started[MAX_BATCH_THREADS];
+	int i, failed = 0;
+	
+	if (!set || (!requests && count > 0) || count < 0)
+		return set_error(ERR_HANDLE);
+	/* Each read is a synchronous cross-CPU call into the kernel, so large
+	   batches are spread over a few threads; small ones are not worth the
+	   thread creation */
+	if (threads <= 0)
+		threads = count / MIN_READS_PER_THREAD;
+	if (threads > MAX_BATCH_THREADS)
+		threads = MAX_BATCH_THREADS;
+	if (threads > set->num_cpus)
+		threads = set->num_cpus;
+	if (threads < 1)
+		threads = 1;
+	for (i = 0; i < threads; i++) {
+		parts[i].set = set;
+		parts[i].requests = requests;
+		parts[i].count = count;
+		parts[i].part = i;
+		parts[i].num_parts = threads;
+		started[i] = i > 0 && pthread_create(&tids[i], NULL, read_batch_part, &parts[i]) == 0;
+	}
+	read_batch_part(&parts[0]);
+	for (i = 1; i < threads; i++) {
+		if (started[i])
+			pthread_join(tids[i], NULL);
+		else
+			read_batch_part(&parts[i]);
+	}
+	for (i = 0; i < count; i++) {
+		if (requests[i].cpu < 0)
+			requests[i].error = ERR_HANDLE;
+		if (requests[i].error)
+			failed++;
+	}
+	return set_error(failed ? ERR_INVMSR : ERR_OK);
+}
+
+void cpu_msr_close_all(struct msr_cpu_set_t* set)
+{
+	int i;
+	if (!set) return;
+	for (i = 0; i < set->num_cpus; i++)
+		cpu_msr_driver_close(set->handles[i]);
+	free(set->handles);
+	free(set);
+}
+#define MSR_CPU_SET_DEFINED
 #  endif /* __APPLE__ */
 #else /* _WIN32 */
 #include <windows.h>
@@ -125,9 +329,11 @@ struct msr_driver_t {
 	HANDLE hhDriver;
 	OVERLAPPED ovl;
 	int errorcode;
+	struct perfmsr_state_t mperf, aperf;
 };
 
 static int rdmsr_supported(void);
+static void perfmsr_prime(struct msr_driver_t* handle);
 static int extract_driver(struct msr_driver_t* driver);
 static int load_driver(struct msr_driver_t* driver);
 
@@ -161,9 +367,20 @@ struct msr_driver_t* cpu_msr_driver_open(void)
 		free(drv);
 		return NULL;
 	}
+	perfmsr_prime(drv);
 	return drv;
 }
 
+/* The driver reads the MSRs of whichever CPU the calling thread runs on */
+struct msr_driver_t* cpu_msr_driver_open_core(unsigned core_num)
+{
+	if (core_num != 0) {
+		set_error(ERR_NOT_IMP);
+		return NULL;
+	}
+	return cpu_msr_driver_open();
+}
+
 typedef BOOL (WINAPI *LPFN_ISWOW64PROCESS) (HANDLE, PBOOL);
 static BOOL is_running_x64(void)
 {
@@ -326,7 +543,7 @@ clean_up:
 #define IOCTL_UNKNOWN_BASE              FILE_DEVICE_UNKNOWN
 #define IOCTL_PROCVIEW_RDMSR			CTL_CODE(IOCTL_UNKNOWN_BASE, 0x0803, METHOD_BUFFERED, FILE_READ_ACCESS | FILE_WRITE_ACCESS)
 
-int cpu_rdmsr(struct msr_driver_t* driver, int msr_index, uint64_t* result)
+int cpu_rdmsr(struct msr_driver_t* driver, uint32_t msr_index, uint64_t* result)
 {
 	DWORD dwBytesReturned;
 	__int64 msrdata;
@@ -334,7 +551,7 @@ int cpu_rdmsr(struct msr_driver_t* driver, int msr_index, uint64_t* result)
 
 	if (!driver)
 		return set_error(ERR_HANDLE);
-	DeviceIoControl(driver->hhDriver, IOCTL_PROCVIEW_RDMSR, &msr_index, sizeof(int), &msrdata, sizeof(__int64), &dwBytesReturned, &driver->ovl);
+	DeviceIoControl(driver->hhDriver, IOCTL_PROCVIEW_RDMSR, &msr_index, sizeof(msr_index), &msrdata, sizeof(__int64), &dwBytesReturned, &driver->ovl);
 	GetOverlappedResult(driver->hhDriver, &driver->ovl, &dwBytesReturned, TRUE);	
 	*result = msrdata;
 	return 0;
@@ -362,28 +579,74 @@ int cpu_msr_driver_close(struct msr_driver_t* drv)
 
 #endif /* _WIN32 */
 
+#ifndef MSR_CPU_SET_DEFINED
+struct msr_cpu_set_t { int dummy; };
+struct msr_cpu_set_t* cpu_msr_open_all(void)
+{
+	set_error(ERR_NOT_IMP);
+	return NULL;
+}
+
+int cpu_msr_set_size(struct msr_cpu_set_t* set)
+{
+	return 0;
+}
+
+struct msr_driver_t* cpu_msr_set_handle(struct msr_cpu_set_t* set, int cpu)
+{
+	return NULL;
+}
+
+int cpu_rdmsr_batch(struct msr_cpu_set_t* set, struct msr_request_t* requests, int count, int threads)
+{
+	return set_error(ERR_NOT_IMP);
+}
+
+void cpu_msr_close_all(struct msr_cpu_set_t* set)
+{
+}
+#endif /* MSR_CPU_SET_DEFINED */
+
 static int rdmsr_supported(void)
 {
 	struct cpu_id_t* id = get_cached_cpuid();
 	return id->flags[CPU_FEATURE_MSR];
 }
 
-static int perfmsr_measure(struct msr_driver_t* handle, int msr)
+#ifndef MSRINFO_DEFINED
+/* Takes the first readings of the performance counters, so that the first
+   cpu_msrinfo() call already has something to compare against */
+static void perfmsr_prime(struct msr_driver_t* handle)
+{
+	uint64_t clock;
+	sys_precise_clock(&clock);
+	if (cpu_rdmsr(handle, MSR_MPERF, &handle->mperf.value) == 0)
+		handle->mperf.clock = clock;
+	if (cpu_rdmsr(handle, MSR_APERF, &handle->aperf.value) == 0)
+		handle->aperf.clock = clock;
+	set_error(ERR_OK);
+}
+
+/* Returns the rate of a counter, in counts per microsecond (i.e. MHz),
+   since the previous call (or since the driver was opened) */
+static int perfmsr_measure(struct msr_driver_t* handle, uint32_t msr, struct perfmsr_state_t* state)
 {
 	int err;
-	uint64_t a, b;
-	uint64_t x, y;
-	err = cpu_rdmsr(handle, msr, &x);
+	uint64_t clock, value, result;
+	err = cpu_rdmsr(handle, msr, &value);
 	if (err) return CPU_INVALID_VALUE;
-	sys_precise_clock(&a);
-	busy_loop_delay(10);
-	cpu_rdmsr(handle, msr, &y);
-	sys_precise_clock(&b);
-	if (a >= b || x > y) return CPU_INVALID_VALUE;
-	return (int) ((y - x) / (b - a));
+	sys_precise_clock(&clock);
+	if (state->clock == 0 || clock <= state->clock || value < state->value) {
+		state->value = value;
+		state->clock = clock;
+		return CPU_INVALID_VALUE;
+	}
+	result = (value - state->value) / (clock - state->clock);
+	state->value = value;
+	state->clock = clock;
+	return (int) result;
 }
 
-#ifndef MSRINFO_DEFINED
 int cpu_msrinfo(struct msr_driver_t* handle, cpu_msrinfo_request_t which)
 {
 	uint64_t r;
@@ -393,9 +656,9 @@ int cpu_msrinfo(struct msr_driver_t* handle, cpu_msrinfo_request_t which)
 		return set_error(ERR_HANDLE);
 	switch (which) {
 		case INFO_MPERF:
-			return perfmsr_measure(handle, 0xe7);
+			return perfmsr_measure(handle, MSR_MPERF, &handle->mperf);
 		case INFO_APERF:
-			return perfmsr_measure(handle, 0xe8);
+			return perfmsr_measure(handle, MSR_APERF, &handle->aperf);
 		case INFO_CUR_MULTIPLIER:
 		{
 			err = cpu_rdmsr(handle, 0x2a, &r);
@@ -410,9 +673,59 @@ int cpu_msrinfo(struct msr_driver_t* handle, cpu_msrinfo_request_t which)
 		}
 		case INFO_TEMPERATURE:
 		case INFO_THROTTLING:
+		{
+			struct cpu_thermal_info_t thermal;
+			thermal.cpu = 0;
+			if (cpu_thermal_by_msr(handle, &thermal) != 0)
+				return CPU_INVALID_VALUE;
+			if (which == INFO_TEMPERATURE)
+				return thermal.core.temperature;
+			return thermal.core.throttling;
+		}
 		default:
 			return CPU_INVALID_VALUE;
 	}
 }
 #endif // MSRINFO_DEFINED
 
+
+int cpu_read_perf_sample(struct msr_driver_t* handle, struct cpu_perf_sample_t* sample)
+{
+	int err;
+	
+	if (!handle || !sample)
+		return set_error(ERR_HANDLE);
+	/* The TSC and the clock are read just before the counters, and the
+	   counters back to back, so that all of them cover the same window to
+	   within the time of the MSR reads */
+	cpu_rdtsc(&sample->tsc);
+	sys_monotonic_clock_ns(&sample->ns);
+	if ((err = cpu_rdmsr(handle, MSR_MPERF, &sample->mperf)) != 0)
+		return err;
+	if ((err = cpu_rdmsr(handle, MSR_APERF, &sample->aperf)) != 0)
+		return err;
+	return set_error(ERR_OK);
+}
+
+int cpu_perf_delta(const struct cpu_perf_sample_t* prev, const struct cpu_perf_sample_t* cur, struct cpu_perf_delta_t* delta)
+{
+	uint64_t dtsc, dmperf, daperf;
+	
+	memset(delta, 0, sizeof(struct cpu_perf_delta_t));
+	if (cur->ns <= prev->ns || cur->tsc <= prev->tsc ||
+	    cur->mperf < prev->mperf || cur->aperf < prev->aperf)
+		return set_error(ERR_BADFMT);
+	dtsc = cur->tsc - prev->tsc;
+	dmperf = cur->mperf - prev->mperf;
+	daperf = cur->aperf - prev->aperf;
+	delta->elapsed_ns = cur->ns - prev->ns;
+	delta->tsc_mhz = (double) dtsc * 1000.0 / (double) delta->elapsed_ns;
+	delta->average_mhz = (double) daperf * 1000.0 / (double) delta->elapsed_ns;
+	delta->busy = (double) dmperf / (double) dtsc;
+	if (delta->busy > 1.0)
+		delta->busy = 1.0;
+	/* A CPU that stayed idle for the whole window has no busy frequency */
+	if (dmperf > 0)
+		delta->effective_mhz = delta->tsc_mhz * (double) daperf / (double) dmperf;
+	return set_error(ERR_OK);
+}
@@ -25,6 +25,7 @@
  */
 #include <stdio.h>
 #include <string.h>
+#include <math.h>
 #include "libcpuid.h"
 #include "libcpuid_util.h"
 #include "asm-bits.h"
@@ -32,6 +33,20 @@
 
 #ifdef _WIN32
 #include <windows.h>
+void sys_monotonic_clock_ns(uint64_t *result)
+{
+	LARGE_INTEGER freq, counter;
+	QueryPerformanceCounter(&counter);
+	QueryPerformanceFrequency(&freq);
+	*result = (uint64_t) (counter.QuadPart / freq.QuadPart) * 1000000000 +
+	          (uint64_t) (counter.QuadPart % freq.QuadPart) * 1000000000 / freq.QuadPart;
+}
+
+void sys_sleep_ms(int milliseconds)
+{
+	Sleep(milliseconds);
+}
+
 void sys_precise_clock(uint64_t *result)
 {
 	double c, f;
@@ -44,13 +59,44 @@ void sys_precise_clock(uint64_t *result)
 }
 #else
 /* assuming Linux, Mac OS or other POSIX */
-#include <sys/time.h>
+#include <time.h>
+#ifdef __APPLE__
+#include <mach/mach_time.h>
+void sys_monotonic_clock_ns(uint64_t *result)
+{
+	static mach_timebase_info_data_t timebase;
+	if (timebase.denom == 0)
+		mach_timebase_info(&timebase);
+	*result = mach_absolute_time() * timebase.numer / timebase.denom;
+}
+#else
+/* CLOCK_MONOTONIC_RAW is not slewed by NTP, so its rate is that of the
+   hardware clock source, which is what the TSC is compared against */
+void sys_monotonic_clock_ns(uint64_t *result)
+{
+	struct timespec ts;
+#ifdef CLOCK_MONOTONIC_RAW
+	if (clock_gettime(CLOCK_MONOTONIC_RAW, &ts) != 0)
+#endif
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+	*result = (uint64_t) ts.tv_sec * (uint64_t) 1000000000 +
+	          (uint64_t) ts.tv_nsec;
+}
+#endif /* __APPLE__ */
+
+void sys_sleep_ms(int milliseconds)
+{
+	struct timespec ts;
+	ts.tv_sec = milliseconds / 1000;
+	ts.tv_nsec = (long) (milliseconds % 1000) * 1000000;
+	while (nanosleep(&ts, &ts) == -1)
+		;
+}
+
 void sys_precise_clock(uint64_t *result)
 {
-	struct timeval tv;
-	gettimeofday(&tv, NULL);
-	*result = (uint64_t) tv.tv_sec * (uint64_t) 1000000 +
-	          (uint64_t) tv.tv_usec;
+	sys_monotonic_clock_ns(result);
+	*result /= 1000;
 }
 #endif /* _WIN32 */
 
@@ -145,9 +191,41 @@ int cpu_clock_by_os(void)
 	fclose(f);
 	return -1;
 }
+
+/* Reads a cpufreq attribute of CPU 0, in kHz, and returns it in MHz */
+static int read_cpufreq_mhz(const char* attribute)
+{
+	FILE *f;
+	char path[128];
+	long khz;
+	
+	snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cpufreq/%s", attribute);
+	f = fopen(path, "rt");
+	if (!f) return -1;
+	if (1 != fscanf(f, "%ld", &khz))
+		khz = -1;
+	fclose(f);
+	return khz > 0 ? (int) (khz / 1000) : -1;
+}
+
+/* intel_pstate exports the base (nominal) frequency; other drivers only
+   export the maximum one */
+#define CLOCK_BY_SYSFS_DEFINED
+static void cpu_clock_by_sysfs(int* base_mhz, int* max_mhz)
+{
+	*base_mhz = read_cpufreq_mhz("base_frequency");
+	*max_mhz = read_cpufreq_mhz("cpuinfo_max_freq");
+}
 #endif /* __APPLE__ */
 #endif /* _WIN32 */
 
+#ifndef CLOCK_BY_SYSFS_DEFINED
+static void cpu_clock_by_sysfs(int* base_mhz, int* max_mhz)
+{
+	*base_mhz = *max_mhz = -1;
+}
+#endif /* CLOCK_BY_SYSFS_DEFINED */
+
 /* Emulate doing useful CPU intensive work */
 static int busy_loop(int amount)
 {
@@ -275,6 +353,260 @@ int cpu_clock_by_ic(int millis, int runs)
 	return max_value;
 }
 
+/* Reads the TSC and the monotonic clock as close together as possible: of a
+   few attempts, keeps the one where the clock reads bracket the TSC read
+   most tightly, and pairs the TSC with their midpoint */
+static void tsc_clock_pair(uint64_t* tsc, uint64_t* ns)
+{
+	int i;
+	uint64_t t, before, after, best = (uint64_t) -1;
+	for (i = 0; i < 8; i++) {
+		sys_monotonic_clock_ns(&before);
+		cpu_rdtsc(&t);
+		sys_monotonic_clock_ns(&after);
+		if (after - before < best) {
+			best = after - before;
+			*tsc = t;
+			*ns = before + (after - before) / 2;
+		}
+	}
+}
+
+#define MAX_CALIBRATION_SAMPLES 128
+
+/* Fits tsc = a + b * ns by least squares, with both axes relative to the
+   first sample. Returns the slope (ticks per ns), its standard error, and
+   the fitted TSC value at the last sample */
+static double fit_tsc_line(const double* x, const double* y, int n,
+                           double* slope_error, double* last_y)
+{
+	int i;
+	double mx = 0, my = 0, sxx = 0, sxy = 0, ssr = 0, a, b, r;
+	for (i = 0; i < n; i++) {
+		mx += x[i];
+		my += y[i];
+	}
+	mx /= n;
+	my /= n;
+	for (i = 0; i < n; i++) {
+		sxx += (x[i] - mx) * (x[i] - mx);
+		sxy += (x[i] - mx) * (y[i] - my);
+	}
+	b = sxy / sxx;
+	a = my - b * mx;
+	for (i = 0; i < n; i++) {
+		r = y[i] - (a + b * x[i]);
+		ssr += r * r;
+	}
+	*slope_error = sqrt(ssr / (n - 2) / sxx);
+	*last_y = a + b * x[n - 1];
+	return b;
+}
+
+/* Two-sided 95% quantile of Student's t distribution */
+static double student_t95(int df)
+{
+	static const double table[] = {
+		12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+		2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+	};
+	if (df < 1) return 0;
+	if (df <= (int) COUNT_OF(table)) return table[df - 1];
+	return df <= 60 ? 2.0 : 1.96;
+}
+
+int cpu_tsc_calibrate(int millis, struct cpu_tsc_calibration_t* cal)
+{
+	struct cpu_raw_data_t raw;
+	uint64_t tsc0, ns0, tsc, ns;
+	double x[MAX_CALIBRATION_SAMPLES], y[MAX_CALIBRATION_SAMPLES];
+	double slope, slope_error, last_y;
+	int i, n, step;
+	
+	memset(cal, 0, sizeof(struct cpu_tsc_calibration_t));
+	if (millis < 1)
+		return set_error(ERR_HANDLE);
+	if (!cpuid_present())
+		return set_error(ERR_NO_CPUID);
+	cpu_exec_cpuid(0x80000000, raw.ext_cpuid[0]);
+	if (raw.ext_cpuid[0][0] < 0x80000007)
+		return set_error(ERR_NO_INVTSC);
+	cpu_exec_cpuid(0x80000001, raw.ext_cpuid[1]);
+	cpu_exec_cpuid(0x80000007, raw.ext_cpuid[7]);
+	if (!(raw.ext_cpuid[7][3] & (1 << 8)))
+		return set_error(ERR_NO_INVTSC);
+	cal->rdtscp = (raw.ext_cpuid[1][3] >> 27) & 1;
+	
+	/* One sample per millisecond (or fewer, on long intervals); the samples
+	   in between cost nothing, since the thread sleeps */
+	n = millis + 1;
+	step = 1;
+	if (n > MAX_CALIBRATION_SAMPLES) {
+		step = (millis + MAX_CALIBRATION_SAMPLES - 2) / (MAX_CALIBRATION_SAMPLES - 1);
+		n = millis / step + 1;
+	}
+	if (n < 3)
+		n = 3;
+	tsc_clock_pair(&tsc0, &ns0);
+	x[0] = y[0] = 0;
+	for (i = 1; i < n; i++) {
+		sys_sleep_ms(step);
+		tsc_clock_pair(&tsc, &ns);
+		if (tsc <= tsc0 || ns <= ns0)
+			return set_error(ERR_NO_RDTSC);
+		x[i] = (double) (ns - ns0);
+		y[i] = (double) (tsc - tsc0);
+	}
+	slope = fit_tsc_line(x, y, n, &slope_error, &last_y);
+	if (slope <= 0)
+		return set_error(ERR_NO_RDTSC);
+	cal->ns_base = ns;
+	cal->tsc_base = tsc0 + (uint64_t) (last_y + 0.5);
+	cal->hz = slope * 1e9;
+	cal->ns_per_tick = 1e9 / cal->hz;
+	cal->hz_error = student_t95(n - 2) * slope_error * 1e9;
+	cal->samples = n;
+	return set_error(ERR_OK);
+}
+
+int cpu_clock_measure_adaptive(double tolerance, int budget_ms, struct cpu_clock_estimate_t* estimate)
+{
+	uint64_t tsc0, ns0, tsc, ns, start, window;
+	double mhz, mean = 0, m2 = 0, delta, error = 0;
+	int k = 0, warmup = 1;
+	
+	if (estimate)
+		memset(estimate, 0, sizeof(struct cpu_clock_estimate_t));
+	if (tolerance <= 0 || budget_ms < 1)
+		return -1;
+	window = budget_ms < 10 ? (uint64_t) budget_ms * 100000 : 1000000;
+	tsc_clock_pair(&tsc0, &ns0);
+	start = ns0;
+	do {
+		/* Busy-wait one window; reading the clock is the work */
+		do {
+			sys_monotonic_clock_ns(&ns);
+		} while (ns - ns0 < window);
+		tsc_clock_pair(&tsc, &ns);
+		if (tsc <= tsc0 || ns <= ns0)
+			return -1;
+		mhz = (double) (tsc - tsc0) * 1000.0 / (double) (ns - ns0);
+		tsc0 = tsc;
+		ns0 = ns;
+		if (warmup) {
+			warmup = 0;
+			continue;
+		}
+		/* Welford's running mean and variance */
+		k++;
+		delta = mhz - mean;
+		mean += delta / k;
+		m2 += delta * (mhz - mean);
+		if (k >= 3) {
+			error = student_t95(k - 1) * sqrt(m2 / (k - 1) / k);
+			if (error <= tolerance * mean)
+				break;
+		}
+	} while (ns - start < (uint64_t) budget_ms * 1000000);
+	if (k == 0)
+		return -1;
+	if (estimate) {
+		estimate->mhz = mean;
+		estimate->error_mhz = error;
+		estimate->windows = k;
+		estimate->elapsed_ms = (int) ((ns - start) / 1000000);
+	}
+	return (int) (mean + 0.5);
+}
+
+int cpu_clock_resolve(const struct cpu_raw_data_t* raw, struct cpu_clock_info_t* info)
+{
+	struct cpu_raw_data_t own;
+	uint32_t max_basic;
+	const uint32_t* leaf15;
+	const uint32_t* leaf16;
+	int sysfs_base, sysfs_max;
+	
+	memset(info, 0, sizeof(struct cpu_clock_info_t));
+	info->base_mhz = info->max_mhz = info->bus_mhz = -1;
+	info->source = CLOCK_SOURCE_NONE;
+	if (!raw) {
+		if (cpuid_get_raw_data(&own) < 0)
+			return -1;
+		raw = &own;
+	}
+	max_basic = raw->basic_cpuid[0][0];
+	if (raw->ext_cpuid[0][0] >= 0x80000007)
+		info->invariant_tsc = (raw->ext_cpuid[7][3] >> 8) & 1;
+	
+	/* Leaf 16h: base, maximum and bus frequency, in MHz */
+	leaf16 = raw->basic_cpuid[0x16];
+	if (max_basic >= 0x16 && (leaf16[0] & 0xffff) != 0) {
+		info->base_mhz = leaf16[0] & 0xffff;
+		info->max_mhz = (leaf16[1] & 0xffff) ? (int) (leaf16[1] & 0xffff) : -1;
+		info->bus_mhz = (leaf16[2] & 0xffff) ? (int) (leaf16[2] & 0xffff) : -1;
+		info->source = CLOCK_SOURCE_CPUID_16H;
+	}
+	
+	/* Leaf 15h: TSC = crystal * EBX / EAX. Some processors leave the
+	   crystal frequency (ECX) zero; it can then be derived from the base
+	   frequency, which the TSC runs at */
+	leaf15 = raw->basic_cpuid[0x15];
+	if (max_basic >= 0x15 && leaf15[0] != 0 && leaf15[1] != 0) {
+		if (leaf15[2] != 0)
+			info->tsc_hz = (double) leaf15[2] * leaf15[1] / leaf15[0];
+		else if (info->base_mhz > 0)
+			info->tsc_hz = info->base_mhz * 1e6;
+		if (info->base_mhz <= 0 && info->tsc_hz > 0) {
+			info->base_mhz = (int) (info->tsc_hz / 1e6 + 0.5);
+			info->source = CLOCK_SOURCE_CPUID_15H;
+		}
+	}
+	if (info->base_mhz > 0)
+		return info->base_mhz;
+	
+	cpu_clock_by_sysfs(&sysfs_base, &sysfs_max);
+	if (info->max_mhz <= 0)
+		info->max_mhz = sysfs_max;
+	if (sysfs_base > 0 || sysfs_max > 0) {
+		info->base_mhz = sysfs_base > 0 ? sysfs_base : sysfs_max;
+		info->source = CLOCK_SOURCE_SYSFS;
+		return info->base_mhz;
+	}
+	
+	info->base_mhz = cpu_clock_by_os();
+	if (info->base_mhz > 0) {
+		info->source = CLOCK_SOURCE_OS;
+		return info->base_mhz;
+	}
+	
+	info->base_mhz = cpu_clock_measure_adaptive(0.001, 200, NULL);
+	if (info->base_mhz > 0) {
+		info->source = CLOCK_SOURCE_MEASURED;
+		return info->base_mhz;
+	}
+	info->base_mhz = -1;
+	return -1;
+}
+
+const char* cpu_clock_source_str(cpu_clock_source_t source)
+{
+	const struct { cpu_clock_source_t source; const char* name; }
+	matchtable[] = {
+		{ CLOCK_SOURCE_NONE, "none" },
+		{ CLOCK_SOURCE_CPUID_16H, "cpuid-16h" },
+		{ CLOCK_SOURCE_CPUID_15H, "cpuid-15h" },
+		{ CLOCK_SOURCE_SYSFS, "sysfs" },
+		{ CLOCK_SOURCE_OS, "os" },
+		{ CLOCK_SOURCE_MEASURED, "measured" },
+	};
+	unsigned i;
+	for (i = 0; i < COUNT_OF(matchtable); i++)
+		if (matchtable[i].source == source)
+			return matchtable[i].name;
+	return "";
+}
+
 int cpu_clock(void)
 {
 	int result;
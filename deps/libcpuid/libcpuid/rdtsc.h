@@ -27,6 +27,8 @@
 #define __RDTSC_H__
 
 void sys_precise_clock(uint64_t *result);
+void sys_monotonic_clock_ns(uint64_t *result);
+void sys_sleep_ms(int milliseconds);
 int busy_loop_delay(int milliseconds);
 
 
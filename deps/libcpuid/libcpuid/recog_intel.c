@@ -506,6 +506,8 @@ static void decode_intel_deterministic_cache_info(struct cpu_raw_data_t* raw,
 			type = L2;
 		else if (level == 3 && typenumber == 3)
 			type = L3;
+		else if (level > 3)
+			continue; /* e.g. an L4 eDRAM cache; not reported in cpu_id_t */
 		else {
 			warnf("deterministic_cache: unknown level/typenumber combo (%d/%d), cannot\n", level, typenumber);
 			warnf("deterministic_cache: recognize cache type\n");
@@ -0,0 +1,344 @@
+/*
+ * Copyright 2026  cpuid-node contributors
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "libcpuid.h"
+#include "libcpuid_util.h"
+
+#define MSR_IA32_THERM_STATUS		0x19c
+#define MSR_IA32_TEMPERATURE_TARGET	0x1a2
+#define MSR_IA32_PACKAGE_THERM_STATUS	0x1b1
+
+/* Bits shared by IA32_THERM_STATUS and IA32_PACKAGE_THERM_STATUS */
+#define THERM_STATUS			(1 << 0)
+#define THERM_STATUS_LOG		(1 << 1)
+#define THERM_PROCHOT			(1 << 2)
+#define THERM_PROCHOT_LOG		(1 << 3)
+#define THERM_POWER_LIMIT		(1 << 10)
+#define THERM_POWER_LIMIT_LOG		(1 << 11)
+#define THERM_READING_VALID		(1u << 31)
+
+#define DEFAULT_TJMAX 100
+
+static void thermal_status_t_constructor(struct cpu_thermal_status_t* status)
+{
+	status->temperature = CPU_INVALID_VALUE;
+	status->tjmax = -1;
+	status->throttling = status->throttle_log = -1;
+	status->prochot = status->prochot_log = -1;
+	status->power_limit = status->power_limit_log = -1;
+	status->throttle_count = -1;
+}
+
+static void thermal_info_t_constructor(struct cpu_thermal_info_t* info, int cpu)
+{
+	memset(info, 0, sizeof(struct cpu_thermal_info_t));
+	info->cpu = cpu;
+	info->source = THERMAL_SOURCE_NONE;
+	thermal_status_t_constructor(&info->core);
+	thermal_status_t_constructor(&info->package);
+}
+
+static int intel_thermal_msrs(void)
+{
+	struct cpu_id_t* id = get_cached_cpuid();
+	return id && id->vendor == VENDOR_INTEL && id->flags[CPU_FEATURE_MSR];
+}
+
+static void decode_therm_status(uint64_t r, int tjmax, struct cpu_thermal_status_t* status)
+{
+	status->tjmax = tjmax;
+	if (r & THERM_READING_VALID)
+		status->temperature = tjmax - (int) ((r >> 16) & 0x7f);
+	status->throttling = (r & THERM_STATUS) ? 1 : 0;
+	status->throttle_log = (r & THERM_STATUS_LOG) ? 1 : 0;
+	status->prochot = (r & THERM_PROCHOT) ? 1 : 0;
+	status->prochot_log = (r & THERM_PROCHOT_LOG) ? 1 : 0;
+	status->power_limit = (r & THERM_POWER_LIMIT) ? 1 : 0;
+	status->power_limit_log = (r & THERM_POWER_LIMIT_LOG) ? 1 : 0;
+}
+
+int cpu_thermal_by_msr(struct msr_driver_t* handle, struct cpu_thermal_info_t* info)
+{
+	uint64_t r;
+	int tjmax = DEFAULT_TJMAX, err;
+	
+	thermal_info_t_constructor(info, info->cpu);
+	if (!handle)
+		return set_error(ERR_HANDLE);
+	if (!intel_thermal_msrs())
+		return set_error(ERR_CPU_UNKN);
+	/* Processors without IA32_TEMPERATURE_TARGET use 100 C */
+	if (cpu_rdmsr(handle, MSR_IA32_TEMPERATURE_TARGET, &r) == 0 && ((r >> 16) & 0xff) != 0)
+		tjmax = (int) ((r >> 16) & 0xff);
+	if ((err = cpu_rdmsr(handle, MSR_IA32_THERM_STATUS, &r)) != 0)
+		return err;
+	decode_therm_status(r, tjmax, &info->core);
+	/* Only present if CPUID.06H:EAX[6] (PTM) is set; a missing one is fine */
+	if (cpu_rdmsr(handle, MSR_IA32_PACKAGE_THERM_STATUS, &r) == 0)
+		decode_therm_status(r, tjmax, &info->package);
+	info->source = THERMAL_SOURCE_MSR;
+	return set_error(ERR_OK);
+}
+
+#if defined(__linux__)
+#define MAX_HWMON 64
+#define MAX_HWMON_TEMPS 256
+
+/* One temperature sensor of the coretemp (or k10temp) driver */
+struct hwmon_sensor_t {
+	int hwmon, index;
+	int package;	/* physical package id */
+	int core;	/* core id, or -1 for the package sensor */
+};
+
+struct hwmon_map_t {
+	int count;
+	struct hwmon_sensor_t sensors[MAX_HWMON_TEMPS];
+};
+
+static int read_long(const char* path, long* value)
+{
+	FILE* f = fopen(path, "rt");
+	int ok;
+	if (!f) return 0;
+	ok = fscanf(f, "%ld", value) == 1;
+	fclose(f);
+	return ok;
+}
+
+static int read_line(const char* path, char* buf, int size)
+{
+	FILE* f = fopen(path, "rt");
+	char* nl;
+	if (!f) return 0;
+	if (!fgets(buf, size, f))
+		buf[0] = 0;
+	fclose(f);
+	if ((nl = strchr(buf, '\n')) != NULL)
+		*nl = 0;
+	return buf[0] != 0;
+}
+
+static void add_sensor(struct hwmon_map_t* map, int hwmon, int index, int package, int core)
+{
+	if (map->count >= MAX_HWMON_TEMPS) return;
+	map->sensors[map->count].hwmon = hwmon;
+	map->sensors[map->count].index = index;
+	map->sensors[map->count].package = package;
+	map->sensors[map->count].core = core;
+	map->count++;
+}
+
+/* coretemp registers one hwmon device per package, labelled "Package id N"
+   and "Core N"; k10temp one per package (node), with a single Tctl / Tdie
+   sensor, numbered in probe order */
+static void build_hwmon_map(const char* sysfs_root, struct hwmon_map_t* map)
+{
+	char path[256], name[32], label[32];
+	int hwmon, index, package, core, k10_package = 0, k10_found;
+	int package_labelled, first_core;
+	
+	map->count = 0;
+	for (hwmon = 0; hwmon < MAX_HWMON; hwmon++) {
+		snprintf(path, sizeof(path), "%s/class/hwmon/hwmon%d/name", sysfs_root, hwmon);
+		if (!read_line(path, name, sizeof(name)))
+			continue;
+		if (!strcmp(name, "coretemp")) {
+			package = -1;
+			package_labelled = 0;
+			first_core = map->count;
+			for (index = 1; index < MAX_HWMON_TEMPS; index++) {
+				snprintf(path, sizeof(path), "%s/class/hwmon/hwmon%d/temp%d_label", sysfs_root, hwmon, index);
+				if (!read_line(path, label, sizeof(label)))
+					continue;
+				if (sscanf(label, "Package id %d", &package) == 1) {
+					add_sensor(map, hwmon, index, package, -1);
+					package_labelled = 1;
+				} else if (sscanf(label, "Core %d", &core) == 1) {
+					add_sensor(map, hwmon, index, -1, core);
+				}
+			}
+			/* The package label can come after the cores */
+			for (index = first_core; index < map->count; index++)
+				if (map->sensors[index].core >= 0)
+					map->sensors[index].package = package_labelled ? package : 0;
+		} else if (!strcmp(name, "k10temp") || !strcmp(name, "zenpower")) {
+			k10_found = 0;
+			for (index = 1; index < 8 && !k10_found; index++) {
+				snprintf(path, sizeof(path), "%s/class/hwmon/hwmon%d/temp%d_label", sysfs_root, hwmon, index);
+				if (read_line(path, label, sizeof(label)) &&
+				    (!strcmp(label, "Tdie") || !strcmp(label, "Tctl"))) {
+					add_sensor(map, hwmon, index, k10_package, -1);
+					k10_found = 1;
+				}
+			}
+			k10_package++;
+		}
+	}
+}
+
+static void read_hwmon_sensor(const char* sysfs_root, const struct hwmon_sensor_t* sensor, struct cpu_thermal_status_t* status)
+{
+	char path[256];
+	long value;
+	snprintf(path, sizeof(path), "%s/class/hwmon/hwmon%d/temp%d_input", sysfs_root, sensor->hwmon, sensor->index);
+	if (read_long(path, &value))
+		status->temperature = (int) (value / 1000);
+	/* coretemp reports TjMax as the critical temperature */
+	snprintf(path, sizeof(path), "%s/class/hwmon/hwmon%d/temp%d_crit", sysfs_root, sensor->hwmon, sensor->index);
+	if (read_long(path, &value))
+		status->tjmax = (int) (value / 1000);
+}
+
+static int thermal_by_sysfs(const char* sysfs_root, const struct hwmon_map_t* map, int cpu, struct cpu_thermal_info_t* info)
+{
+	char path[256];
+	long package = 0, core = -1, count;
+	int i, found = 0;
+	
+	thermal_info_t_constructor(info, cpu);
+	snprintf(path, sizeof(path), "%s/devices/system/cpu/cpu%d/topology/physical_package_id", sysfs_root, cpu);
+	read_long(path, &package);
+	snprintf(path, sizeof(path), "%s/devices/system/cpu/cpu%d/topology/core_id", sysfs_root, cpu);
+	read_long(path, &core);
+	for (i = 0; i < map->count; i++) {
+		if (map->sensors[i].package != package)
+			continue;
+		if (map->sensors[i].core == -1) {
+			read_hwmon_sensor(sysfs_root, &map->sensors[i], &info->package);
+			found = 1;
+		} else if (map->sensors[i].core == core) {
+			read_hwmon_sensor(sysfs_root, &map->sensors[i], &info->core);
+			found = 1;
+		}
+	}
+	/* The thermal_throttle counters are the sysfs view of the log bits */
+	snprintf(path, sizeof(path), "%s/devices/system/cpu/cpu%d/thermal_throttle/core_throttle_count", sysfs_root, cpu);
+	if (read_long(path, &count)) {
+		info->core.throttle_count = count;
+		info->core.throttle_log = count > 0;
+		found = 1;
+	}
+	snprintf(path, sizeof(path), "%s/devices/system/cpu/cpu%d/thermal_throttle/package_throttle_count", sysfs_root, cpu);
+	if (read_long(path, &count)) {
+		info->package.throttle_count = count;
+		info->package.throttle_log = count > 0;
+		found = 1;
+	}
+	if (!found)
+		return set_error(ERR_NOT_IMP);
+	info->source = THERMAL_SOURCE_SYSFS;
+	return set_error(ERR_OK);
+}
+
+int cpu_thermal_by_sysfs(const char* sysfs_root, int cpu, struct cpu_thermal_info_t* info)
+{
+	struct hwmon_map_t* map;
+	int result;
+	
+	if (!sysfs_root)
+		sysfs_root = "/sys";
+	map = (struct hwmon_map_t*) malloc(sizeof(struct hwmon_map_t));
+	if (!map)
+		return set_error(ERR_NO_MEM);
+	build_hwmon_map(sysfs_root, map);
+	result = thermal_by_sysfs(sysfs_root, map, cpu, info);
+	free(map);
+	return result;
+}
+
+int cpu_thermal_read_all(struct msr_cpu_set_t* set, const char* sysfs_root, struct cpu_thermal_info_t* infos, int max_cpus)
+{
+	struct hwmon_map_t* map = NULL;
+	int cpu, n = 0;
+	long online;
+	char path[256];
+	
+	if (!infos || max_cpus < 0)
+		return set_error(ERR_HANDLE);
+	if (!sysfs_root)
+		sysfs_root = "/sys";
+	for (cpu = 0; cpu < max_cpus; cpu++) {
+		if (set && cpu_msr_set_handle(set, cpu)) {
+			infos[n].cpu = cpu;
+			if (cpu_thermal_by_msr(cpu_msr_set_handle(set, cpu), &infos[n]) == 0) {
+				n++;
+				continue;
+			}
+		}
+		/* cpu0 usually has no "online" attribute, but is always online */
+		snprintf(path, sizeof(path), "%s/devices/system/cpu/cpu%d/topology/core_id", sysfs_root, cpu);
+		if (!read_long(path, &online))
+			continue;
+		snprintf(path, sizeof(path), "%s/devices/system/cpu/cpu%d/online", sysfs_root, cpu);
+		if (read_long(path, &online) && !online)
+			continue;
+		if (!map) {
+			map = (struct hwmon_map_t*) malloc(sizeof(struct hwmon_map_t));
+			if (!map)
+				return set_error(ERR_NO_MEM);
+			build_hwmon_map(sysfs_root, map);
+		}
+		if (thermal_by_sysfs(sysfs_root, map, cpu, &infos[n]) == 0)
+			n++;
+	}
+	free(map);
+	set_error(n ? ERR_OK : ERR_NOT_IMP);
+	return n;
+}
+#else /* __linux__ */
+int cpu_thermal_by_sysfs(const char* sysfs_root, int cpu, struct cpu_thermal_info_t* info)
+{
+	thermal_info_t_constructor(info, cpu);
+	return set_error(ERR_NOT_IMP);
+}
+
+int cpu_thermal_read_all(struct msr_cpu_set_t* set, const char* sysfs_root, struct cpu_thermal_info_t* infos, int max_cpus)
+{
+	int cpu, n = 0;
+	if (!infos || max_cpus < 0)
+		return set_error(ERR_HANDLE);
+	for (cpu = 0; cpu < max_cpus && set; cpu++) {
+		if (!cpu_msr_set_handle(set, cpu))
+			continue;
+		infos[n].cpu = cpu;
+		if (cpu_thermal_by_msr(cpu_msr_set_handle(set, cpu), &infos[n]) == 0)
+			n++;
+	}
+	set_error(n ? ERR_OK : ERR_NOT_IMP);
+	return n;
+}
+#endif /* __linux__ */
+
+const char* cpu_thermal_source_str(cpu_thermal_source_t source)
+{
+	switch (source) {
+		case THERMAL_SOURCE_MSR: return "msr";
+		case THERMAL_SOURCE_SYSFS: return "sysfs";
+		default: return "none";
+	}
+}
@@ -0,0 +1,240 @@
+/*
+ * Copyright 2026  cpuid-node contributors
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "libcpuid.h"
+#include "libcpuid_util.h"
+
+static int ceil_log2(uint32_t x)
+{
+	int r = 0;
+	while (r < 32 && ((uint32_t) 1 << r) < x) r++;
+	return r;
+}
+
+/* Walks the levels of leaf 0Bh or 1Fh. The SMT level gives the width of the
+   thread ID field; the last (highest) level gives the width of everything
+   below the package ID. Returns 0 if the leaf reports no levels. */
+static int decode_extended_topology(const uint32_t levels[][4], int count,
+                                    int* smt_shift, int* pkg_shift)
+{
+	int i, type, found = 0;
+	for (i = 0; i < count; i++) {
+		type = (levels[i][2] >> 8) & 0xff;
+		if (type == 0) break;
+		if (type == 1)
+			*smt_shift = levels[i][0] & 0x1f;
+		*pkg_shift = levels[i][0] & 0x1f;
+		found = 1;
+	}
+	return found;
+}
+
+static void decode_apic_shifts(const struct cpu_raw_data_t* raw, int* smt_shift, int* pkg_shift)
+{
+	uint32_t max_basic = raw->basic_cpuid[0][0];
+	uint32_t max_ext = raw->ext_cpuid[0][0];
+	int logical, cores, core_bits;
+	
+	*smt_shift = *pkg_shift = 0;
+	if (max_basic >= 31 && decode_extended_topology(raw->intel_fn31, MAX_INTELFN31_LEVEL, smt_shift, pkg_shift))
+		return;
+	*smt_shift = 0;
+	if (max_basic >= 11 && decode_extended_topology(raw->intel_fn11, MAX_INTELFN11_LEVEL, smt_shift, pkg_shift))
+		return;
+	*smt_shift = *pkg_shift = 0;
+	/* Legacy enumeration. Without the HTT bit there is one CPU per package */
+	if (max_basic < 1 || !(raw->basic_cpuid[1][3] & (1 << 28)))
+		return;
+	logical = (raw->basic_cpuid[1][1] >> 16) & 0xff;
+	*pkg_shift = ceil_log2(logical);
+	if (max_ext >= 0x80000008 && (raw->ext_cpuid[8][2] & 0xff)) {
+		/* AMD: ApicIdCoreIdSize, or the number of cores if it is zero */
+		core_bits = (raw->ext_cpuid[8][2] >> 12) & 0xf;
+		cores = (raw->ext_cpuid[8][2] & 0xff) + 1;
+		*pkg_shift = core_bits ? core_bits : ceil_log2(cores);
+		if (max_ext >= 0x8000001e)
+			*smt_shift = ceil_log2(((raw->ext_cpuid[0x1e][1] >> 8) & 0xff) + 1);
+		return;
+	}
+	if (max_basic >= 4) {
+		/* Intel: the cores per package come from leaf 4 */
+		cores = ((raw->basic_cpuid[4][0] >> 26) & 0x3f) + 1;
+		*smt_shift = *pkg_shift - ceil_log2(cores);
+		if (*smt_shift < 0) *smt_shift = 0;
+	}
+}
+
+static int compare_topology_entries(const void* a, const void* b)
+{
+	const struct cpu_topology_entry_t* x = (const struct cpu_topology_entry_t*) a;
+	const struct cpu_topology_entry_t* y = (const struct cpu_topology_entry_t*) b;
+	if (x->package_id != y->package_id) return x->package_id < y->package_id ? -1 : 1;
+	if (x->core_id != y->core_id) return x->core_id < y->core_id ? -1 : 1;
+	if (x->smt_id != y->smt_id) return x->smt_id < y->smt_id ? -1 : 1;
+	return x->os_cpu - y->os_cpu;
+}
+
+int cpuid_get_topology(const struct cpu_raw_data_array_t* raw, struct cpu_topology_t* topo)
+{
+	int i, smt_shift, pkg_shift;
+	struct cpu_topology_entry_t* e;
+	
+	memset(topo, 0, sizeof(struct cpu_topology_t));
+	if (raw->num_raw <= 0)
+		return set_error(ERR_HANDLE);
+	topo->entries = (struct cpu_topology_entry_t*) calloc(raw->num_raw, sizeof(struct cpu_topology_entry_t));
+	if (!topo->entries)
+		return set_error(ERR_NO_MEM);
+	topo->num_entries = raw->num_raw;
+	for (i = 0; i < raw->num_raw; i++) {
+		decode_apic_shifts(&raw->cpus[i].raw, &smt_shift, &pkg_shift);
+		if (i == 0) {
+			topo->smt_shift = smt_shift;
+			topo->pkg_shift = pkg_shift;
+		}
+		e = &topo->entries[i];
+		e->os_cpu = raw->cpus[i].os_cpu;
+		e->apic_id = raw->cpus[i].apic_id;
+		e->package_id = (int32_t) (pkg_shift < 32 ? e->apic_id >> pkg_shift : 0);
+		e->core_id = (int32_t) ((e->apic_id & (((uint64_t) 1 << pkg_shift) - 1)) >> smt_shift);
+		e->smt_id = (int32_t) (e->apic_id & (((uint32_t) 1 << smt_shift) - 1));
+	}
+	qsort(topo->entries, topo->num_entries, sizeof(struct cpu_topology_entry_t), compare_topology_entries);
+	for (i = 0; i < topo->num_entries; i++) {
+		e = &topo->entries[i];
+		if (i == 0 || e->package_id != e[-1].package_id) {
+			topo->num_packages++;
+			topo->num_cores++;
+		} else if (e->core_id != e[-1].core_id) {
+			topo->num_cores++;
+		}
+	}
+	return set_error(ERR_OK);
+}
+
+void cpuid_free_topology(struct cpu_topology_t* topo)
+{
+	free(topo->entries);
+	memset(topo, 0, sizeof(struct cpu_topology_t));
+}
+
+/* Returns the deterministic cache parameters of a CPU: leaf 4 on Intel,
+   leaf 8000001Dh on AMD. Both share the same register layout. */
+static const uint32_t (*cache_leaves(const struct cpu_raw_data_t* raw, int* count))[4]
+{
+	if (raw->basic_cpuid[0][0] >= 4 && (raw->intel_fn4[0][0] & 0x1f) != 0) {
+		*count = MAX_INTELFN4_LEVEL;
+		return (const uint32_t (*)[4]) raw->intel_fn4;
+	}
+	*count = MAX_AMDFN8000001D_LEVEL;
+	return (const uint32_t (*)[4]) raw->amd_fn8000001d;
+}
+
+static struct cpu_cache_instance_t* find_cache_instance(struct cpu_cache_topology_t* caches,
+                                                        int level, int type, int32_t cache_id)
+{
+	int i;
+	struct cpu_cache_instance_t* c;
+	for (i = 0; i < caches->num_caches; i++) {
+		c = &caches->caches[i];
+		if (c->level == level && c->type == type && c->cache_id == cache_id)
+			return c;
+	}
+	return NULL;
+}
+
+static int add_cache_cpu(struct cpu_cache_topology_t* caches, const uint32_t leaf[4],
+                         uint32_t apic_id, int32_t os_cpu)
+{
+	int type = leaf[0] & 0x1f, level = (leaf[0] >> 5) & 0x7;
+	int shift = ceil_log2(((leaf[0] >> 14) & 0xfff) + 1);
+	int32_t cache_id = (int32_t) (shift < 32 ? apic_id >> shift : 0);
+	int32_t* cpus;
+	struct cpu_cache_instance_t* c = find_cache_instance(caches, level, type, cache_id);
+	
+	if (!c) {
+		c = (struct cpu_cache_instance_t*) realloc(caches->caches,
+			(caches->num_caches + 1) * sizeof(struct cpu_cache_instance_t));
+		if (!c) return 0;
+		caches->caches = c;
+		c = &caches->caches[caches->num_caches++];
+		memset(c, 0, sizeof(struct cpu_cache_instance_t));
+		c->level = level;
+		c->type = type;
+		c->cache_id = cache_id;
+		c->linesize = (leaf[1] & 0xfff) + 1;
+		c->size = (int32_t) ((uint64_t) (((leaf[1] >> 22) & 0x3ff) + 1) *
+			(((leaf[1] >> 12) & 0x3ff) + 1) * c->linesize * (leaf[2] + 1) / 1024);
+	}
+	cpus = (int32_t*) realloc(c->os_cpus, (c->num_cpus + 1) * sizeof(int32_t));
+	if (!cpus) return 0;
+	c->os_cpus = cpus;
+	c->os_cpus[c->num_cpus++] = os_cpu;
+	return 1;
+}
+
+static int compare_cache_instances(const void* a, const void* b)
+{
+	const struct cpu_cache_instance_t* x = (const struct cpu_cache_instance_t*) a;
+	const struct cpu_cache_instance_t* y = (const struct cpu_cache_instance_t*) b;
+	if (x->level != y->level) return x->level - y->level;
+	if (x->type != y->type) return x->type - y->type;
+	return x->cache_id < y->cache_id ? -1 : (x->cache_id > y->cache_id);
+}
+
+int cpuid_get_cache_topology(const struct cpu_raw_data_array_t* raw, struct cpu_cache_topology_t* caches)
+{
+	int i, j, count;
+	const uint32_t (*leaves)[4];
+	
+	memset(caches, 0, sizeof(struct cpu_cache_topology_t));
+	if (raw->num_raw <= 0)
+		return set_error(ERR_HANDLE);
+	/* raw->cpus is in OS CPU order, so every os_cpus list comes out sorted */
+	for (i = 0; i < raw->num_raw; i++) {
+		leaves = cache_leaves(&raw->cpus[i].raw, &count);
+		for (j = 0; j < count; j++) {
+			if ((leaves[j][0] & 0x1f) == 0) break;
+			if (!add_cache_cpu(caches, leaves[j], raw->cpus[i].apic_id, raw->cpus[i].os_cpu)) {
+				cpuid_free_cache_topology(caches);
+				return set_error(ERR_NO_MEM);
+			}
+		}
+	}
+	if (caches->num_caches == 0)
+		return set_error(ERR_NOT_IMP);
+	qsort(caches->caches, caches->num_caches, sizeof(struct cpu_cache_instance_t), compare_cache_instances);
+	return set_error(ERR_OK);
+}
+
+void cpuid_free_cache_topology(struct cpu_cache_topology_t* caches)
+{
+	int i;
+	for (i = 0; i < caches->num_caches; i++)
+		free(caches->caches[i].os_cpus);
+	free(caches->caches);
+	memset(caches, 0, sizeof(struct cpu_cache_topology_t));
+}
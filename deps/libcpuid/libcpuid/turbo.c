@@ -0,0 +1,296 @@
+/*
+ * Copyright 2026  cpuid-node contributors
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#if defined(__linux__)
+#define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "libcpuid.h"
+#include "libcpuid_util.h"
+
+#define MSR_PLATFORM_INFO		0xceu
+#define MSR_IA32_MISC_ENABLE		0x1a0u
+#define MSR_TURBO_RATIO_LIMIT		0x1adu
+#define MSR_TURBO_RATIO_LIMIT1		0x1aeu
+#define MSR_TURBO_RATIO_LIMIT2		0x1afu
+
+#define MSR_AMD_HWCR			0xc0010015u
+#define MSR_AMD_PSTATE_0		0xc0010064u
+
+#define MISC_ENABLE_TURBO_DISABLE	((uint64_t) 1 << 38)
+#define AMD_HWCR_CPB_DIS		((uint64_t) 1 << 25)
+
+static void turbo_table_t_constructor(struct cpu_turbo_table_t* table)
+{
+	memset(table, 0, sizeof(struct cpu_turbo_table_t));
+	table->base_mhz = -1;
+	table->bus_mhz = -1;
+	table->turbo_enabled = -1;
+}
+
+static void add_entry(struct cpu_turbo_table_t* table, int active_cores, int mhz)
+{
+	if (table->num_entries >= MAX_TURBO_ENTRIES || mhz <= 0)
+		return;
+	table->entries[table->num_entries].active_cores = active_cores;
+	table->entries[table->num_entries].mhz = mhz;
+	table->num_entries++;
+}
+
+/* MSR_TURBO_RATIO_LIMIT has the ratio for 1 to 8 active cores, one per byte.
+   From Skylake-SP and Goldmont on, MSR_TURBO_RATIO_LIMIT1 holds the core
+   count of each of those eight groups instead, in ascending order; on
+   Ivy Bridge-EP and Haswell-EP it holds the ratios for 9 to 16 cores, and
+   MSR_TURBO_RATIO_LIMIT2 those for 17 and up. The two layouts are told
+   apart by the ascending counts, since ratios never go up with the core
+   count. */
+static void decode_intel_turbo(struct msr_driver_t* handle, struct cpu_turbo_table_t* table)
+{
+	uint64_t ratios, extra;
+	int i, count, prev, ascending = 1, groups = 0;
+	
+	if (cpu_rdmsr(handle, MSR_TURBO_RATIO_LIMIT, &ratios) != 0)
+		return;
+	if (cpu_rdmsr(handle, MSR_TURBO_RATIO_LIMIT1, &extra) == 0 && extra != 0) {
+		prev = 0;
+		for (i = 0; i < 8; i++) {
+			count = (int) ((extra >> (8 * i)) & 0xff);
+			if (count == 0) break;
+			if (count <= prev) ascending = 0;
+			prev = count;
+			groups++;
+		}
+		if (ascending && groups > 0) {
+			for (i = 0; i < groups; i++)
+				add_entry(table, (int) ((extra >> (8 * i)) & 0xff),
+				          (int) ((ratios >> (8 * i)) & 0xff) * table->bus_mhz);
+			return;
+		}
+	}
+	for (i = 0; i < 8; i++)
+		add_entry(table, i + 1, (int) ((ratios >> (8 * i)) & 0xff) * table->bus_mhz);
+	if (cpu_rdmsr(handle, MSR_TURBO_RATIO_LIMIT1, &extra) != 0)
+		return;
+	for (i = 0; i < 8; i++)
+		add_entry(table, i + 9, (int) ((extra >> (8 * i)) & 0xff) * table->bus_mhz);
+	/* Bit 63 of MSR_TURBO_RATIO_LIMIT2 is a semaphore, not a ratio */
+	if (cpu_rdmsr(handle, MSR_TURBO_RATIO_LIMIT2, &extra) != 0)
+		return;
+	for (i = 0; i < 7; i++)
+		add_entry(table, i + 17, (int) ((extra >> (8 * i)) & 0xff) * table->bus_mhz);
+}
+
+static int intel_turbo_table(struct msr_driver_t* handle, struct cpu_turbo_table_t* table)
+{
+	struct cpu_clock_info_t clock;
+	uint64_t r;
+	int err;
+	
+	/* Sandy Bridge and later run the core ratios off a 100 MHz reference */
+	cpu_clock_resolve(NULL, &clock);
+	table->bus_mhz = clock.bus_mhz > 0 ? clock.bus_mhz : 100;
+	if ((err = cpu_rdmsr(handle, MSR_PLATFORM_INFO, &r)) != 0)
+		return err;
+	table->base_mhz = (int) ((r >> 8) & 0xff) * table->bus_mhz;
+	if (cpu_rdmsr(handle, MSR_IA32_MISC_ENABLE, &r) == 0)
+		table->turbo_enabled = (r & MISC_ENABLE_TURBO_DISABLE) ? 0 : 1;
+	decode_intel_turbo(handle, table);
+	return ERR_OK;
+}
+
+/* Zen P-state MSRs: CoreCOF = CpuFid[7:0] * 200 / CpuDfsId[13:8] MHz;
+   family 1Ah has CpuFid[11:0] in 5 MHz steps instead. P0 is the highest
+   P-state the OS can request; boost goes beyond it, without a published
+   per-core-count table */
+static int amd_turbo_table(struct msr_driver_t* handle, struct cpu_id_t* id, struct cpu_turbo_table_t* table)
+{
+	uint64_t r;
+	uint32_t i;
+	int mhz, fid, dfs;
+	
+	table->bus_mhz = 100;
+	for (i = 0; i < MAX_TURBO_PSTATES; i++) {
+		if (cpu_rdmsr(handle, MSR_AMD_PSTATE_0 + i, &r) != 0)
+			break;
+		if (!(r >> 63))
+			continue;
+		if (id->ext_family >= 0x1a) {
+			mhz = (int) (r & 0xfff) * 5;
+		} else {
+			fid = (int) (r & 0xff);
+			dfs = (int) ((r >> 8) & 0x3f);
+			mhz = dfs ? fid * 200 / dfs : 0;
+		}
+		if (mhz > 0)
+			table->pstate_mhz[table->num_pstates++] = mhz;
+	}
+	if (table->num_pstates == 0)
+		return set_error(ERR_INVMSR);
+	table->base_mhz = table->pstate_mhz[0];
+	if (cpu_rdmsr(handle, MSR_AMD_HWCR, &r) == 0)
+		table->turbo_enabled = (r & AMD_HWCR_CPB_DIS) ? 0 : 1;
+	add_entry(table, id->num_cores > 0 ? id->num_cores : 1, table->pstate_mhz[0]);
+	return ERR_OK;
+}
+
+int cpu_turbo_table(struct msr_driver_t* handle, struct cpu_turbo_table_t* table)
+{
+	struct cpu_id_t* id = get_cached_cpuid();
+	int err;
+	
+	turbo_table_t_constructor(table);
+	if (!handle)
+		return set_error(ERR_HANDLE);
+	if (!id)
+		return set_error(ERR_CPU_UNKN);
+	if (id->vendor == VENDOR_INTEL)
+		err = intel_turbo_table(handle, table);
+	else if (id->vendor == VENDOR_AMD && id->ext_family >= 0x17)
+		err = amd_turbo_table(handle, id, table);
+	else
+		err = ERR_CPU_UNKN;
+	return set_error(err);
+}
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include "rdtsc.h"
+
+struct turbo_probe_t {
+	struct msr_driver_t* handle;
+	int cpu;
+	int millis;
+	double mhz;
+	volatile int* go;
+};
+
+/* Pins itself to its CPU, spins, and measures its own busy frequency */
+static void* turbo_probe_thread(void* arg)
+{
+	struct turbo_probe_t* probe = (struct turbo_probe_t*) arg;
+	struct cpu_perf_sample_t before, after;
+	struct cpu_perf_delta_t delta;
+	cpu_set_t mask;
+	uint64_t start, now;
+	
+	CPU_ZERO(&mask);
+	CPU_SET(probe->cpu, &mask);
+	pthread_setaffinity_np(pthread_self(), sizeof(mask), &mask);
+	while (!*probe->go)
+		;
+	/* Let the clock settle before measuring */
+	sys_monotonic_clock_ns(&start);
+	do {
+		sys_monotonic_clock_ns(&now);
+	} while (now - start < 5000000);
+	if (cpu_read_perf_sample(probe->handle, &before) != 0)
+		return NULL;
+	do {
+		sys_monotonic_clock_ns(&now);
+	} while (now - start < 5000000 + (uint64_t) probe->millis * 1000000);
+	if (cpu_read_perf_sample(probe->handle, &after) == 0 &&
+	    cpu_perf_delta(&before, &after, &delta) == 0)
+		probe->mhz = delta.effective_mhz;
+	return NULL;
+}
+
+static long sysfs_topology_id(int cpu, const char* name)
+{
+	char path[128];
+	long value = -1;
+	FILE* f;
+	snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/%s", cpu, name);
+	if ((f = fopen(path, "rt")) != NULL) {
+		if (fscanf(f, "%ld", &value) != 1)
+			value = -1;
+		fclose(f);
+	}
+	return value;
+}
+
+int cpu_turbo_measure(struct msr_cpu_set_t* set, int active_cores, int millis, double* mhz)
+{
+	struct turbo_probe_t probes[MAX_TURBO_ENTRIES * 8];
+	pthread_t threads[MAX_TURBO_ENTRIES * 8];
+	volatile int go = 0;
+	int cpu, other, n = 0, i, started = 0, distinct, ok = 0;
+	double sum = 0;
+	
+	*mhz = 0;
+	if (!set || active_cores < 1 || active_cores > (int) COUNT_OF(probes) || millis < 1)
+		return set_error(ERR_HANDLE);
+	/* One CPU from each of the first active_cores physical cores, so that
+	   SMT siblings do not count twice */
+	for (cpu = 0; cpu < cpu_msr_set_size(set) && n < active_cores; cpu++) {
+		if (!cpu_msr_set_handle(set, cpu))
+			continue;
+		distinct = 1;
+		for (i = 0; i < n && distinct; i++) {
+			other = probes[i].cpu;
+			if (sysfs_topology_id(other, "core_id") == sysfs_topology_id(cpu, "core_id") &&
+			    sysfs_topology_id(other, "physical_package_id") == sysfs_topology_id(cpu, "physical_package_id"))
+				distinct = 0;
+		}
+		if (!distinct)
+			continue;
+		probes[n].handle = cpu_msr_set_handle(set, cpu);
+		probes[n].cpu = cpu;
+		probes[n].millis = millis;
+		probes[n].mhz = 0;
+		probes[n].go = &go;
+		n++;
+	}
+	if (n < active_cores)
+		return set_error(ERR_HANDLE);
+	for (i = 0; i < n; i++) {
+		if (pthread_create(&threads[i], NULL, turbo_probe_thread, &probes[i]) != 0)
+			break;
+		started++;
+	}
+	go = 1;
+	for (i = 0; i < started; i++)
+		pthread_join(threads[i], NULL);
+	if (started < n)
+		return set_error(ERR_NO_MEM);
+	for (i = 0; i < n; i++) {
+		if (probes[i].mhz > 0) {
+			sum += probes[i].mhz;
+			ok++;
+		}
+	}
+	if (ok == 0)
+		return set_error(ERR_INVMSR);
+	*mhz = sum / ok;
+	return set_error(ERR_OK);
+}
+#else /* __linux__ */
+int cpu_turbo_measure(struct msr_cpu_set_t* set, int active_cores, int millis, double* mhz)
+{
+	*mhz = 0;
+	return set_error(ERR_NOT_IMP);
+}
+#endif /* __linux__ */
@@ -0,0 +1,128 @@
+/*
+ * Copyright 2026  cpuid-node contributors
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <string.h>
+#include "libcpuid.h"
+#include "libcpuid_util.h"
+
+/* XCR0 state components */
+#define XSTATE_X87		(1 << 0)
+#define XSTATE_SSE		(1 << 1)
+#define XSTATE_YMM		(1 << 2)
+#define XSTATE_OPMASK		(1 << 5)
+#define XSTATE_ZMM_HI256	(1 << 6)
+#define XSTATE_HI16_ZMM		(1 << 7)
+#define XSTATE_TILECFG		(1 << 17)
+#define XSTATE_TILEDATA		(1 << 18)
+
+#define XSTATE_AVX		(XSTATE_SSE | XSTATE_YMM)
+#define XSTATE_AVX512		(XSTATE_AVX | XSTATE_OPMASK | XSTATE_ZMM_HI256 | XSTATE_HI16_ZMM)
+#define XSTATE_AMX		(XSTATE_TILECFG | XSTATE_TILEDATA)
+
+#define BIT(reg, n) (((reg) >> (n)) & 1)
+
+/* Returns 1 if the OS saves all of the given components, and leaf 0Dh gives
+   each of them a save area */
+static int xstate_usable(const struct cpu_raw_data_t* raw, uint64_t xcr0, uint64_t mask)
+{
+	int i;
+	if ((xcr0 & mask) != mask)
+		return 0;
+	for (i = 2; i < MAX_INTELFN13_LEVEL && i < 64; i++)
+		if ((mask >> i) & 1 && raw->intel_fn13[i][0] == 0)
+			return 0;
+	return 1;
+}
+
+int cpuid_get_usable_isa(const struct cpu_raw_data_t* raw, struct cpu_usable_isa_t* isa)
+{
+	uint32_t max_basic = raw->basic_cpuid[0][0];
+	uint32_t ecx1 = 0, edx1 = 0, ebx7 = 0;
+	
+	memset(isa, 0, sizeof(struct cpu_usable_isa_t));
+	isa->tier = ISA_TIER_NONE;
+	if (max_basic < 1)
+		return set_error(ERR_NO_CPUID);
+	ecx1 = raw->basic_cpuid[1][2];
+	edx1 = raw->basic_cpuid[1][3];
+	if (max_basic >= 7)
+		ebx7 = raw->intel_fn7[0][1];
+	
+	isa->xcr0 = (uint64_t) raw->xcr0[0] | ((uint64_t) raw->xcr0[1] << 32);
+	if (BIT(ecx1, 27) && max_basic >= 13) {
+		isa->xsave_size = raw->intel_fn13[0][1];
+		isa->xsave_max_size = raw->intel_fn13[0][2];
+	}
+	
+	/* Without OSXSAVE, SSE state is saved by FXSAVE, which every OS that
+	   runs us supports; with it, XCR0 must include the SSE component */
+	isa->sse2 = BIT(edx1, 25) && BIT(edx1, 26) &&
+		(!BIT(ecx1, 27) || (isa->xcr0 & XSTATE_SSE));
+	/* SSE3, SSSE3, SSE4.1, SSE4.2, POPCNT, CX16 (x86-64-v2) */
+	isa->sse4_2 = isa->sse2 && BIT(ecx1, 0) && BIT(ecx1, 9) && BIT(ecx1, 19) &&
+		BIT(ecx1, 20) && BIT(ecx1, 23) && BIT(ecx1, 13);
+	/* AVX needs OSXSAVE and the YMM state to be enabled in XCR0 */
+	isa->avx = isa->sse4_2 && BIT(ecx1, 28) && BIT(ecx1, 27) &&
+		xstate_usable(raw, isa->xcr0, XSTATE_AVX);
+	/* AVX2, FMA3, BMI1, BMI2, F16C, MOVBE (x86-64-v3, minus LZCNT) */
+	isa->avx2 = isa->avx && BIT(ebx7, 5) && BIT(ecx1, 12) && BIT(ebx7, 3) &&
+		BIT(ebx7, 8) && BIT(ecx1, 29) && BIT(ecx1, 22);
+	/* AVX-512 F, CD, BW, DQ, VL (x86-64-v4), with the opmask and ZMM state */
+	isa->avx512 = isa->avx2 && BIT(ebx7, 16) && BIT(ebx7, 28) && BIT(ebx7, 30) &&
+		BIT(ebx7, 17) && BIT(ebx7, 31) &&
+		xstate_usable(raw, isa->xcr0, XSTATE_AVX512);
+	/* AMX-TILE with the tile state enabled */
+	isa->amx = max_basic >= 7 && BIT(raw->intel_fn7[0][3], 24) &&
+		xstate_usable(raw, isa->xcr0, XSTATE_AMX);
+	
+	if (isa->avx512)
+		isa->tier = ISA_TIER_AVX512;
+	else if (isa->avx2)
+		isa->tier = ISA_TIER_AVX2;
+	else if (isa->avx)
+		isa->tier = ISA_TIER_AVX;
+	else if (isa->sse4_2)
+		isa->tier = ISA_TIER_SSE4_2;
+	else if (isa->sse2)
+		isa->tier = ISA_TIER_SSE2;
+	return set_error(ERR_OK);
+}
+
+const char* cpu_isa_tier_str(cpu_isa_tier_t tier)
+{
+	const struct { cpu_isa_tier_t tier; const char* name; }
+	matchtable[] = {
+		{ ISA_TIER_NONE, "none" },
+		{ ISA_TIER_SSE2, "sse2" },
+		{ ISA_TIER_SSE4_2, "sse4.2" },
+		{ ISA_TIER_AVX, "avx" },
+		{ ISA_TIER_AVX2, "avx2" },
+		{ ISA_TIER_AVX512, "avx512" },
+	};
+	unsigned i;
+	for (i = 0; i < COUNT_OF(matchtable); i++)
+		if (matchtable[i].tier == tier)
+			return matchtable[i].name;
+	return "";
+}
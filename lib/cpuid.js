@@ -1,3 +1,5 @@
+var EventEmitter = require('events').EventEmitter;
+
 var cpuid;
 try {
 	cpuid = require('../build/Release/cpuid');
@@ -15,3 +17,336 @@ catch (e) {
 module.exports = function() {
 	return cpuid.getCPUID();
 }
+
+module.exports.refresh = function() {
+	return cpuid.refresh();
+}
+
+module.exports.FEATURE = cpuid.FEATURE;
+
+module.exports.featureBits = function() {
+	return cpuid.getFeatureBits();
+}
+
+module.exports.hasFeature = function(bits, feature) {
+	return ((bits[feature >>> 5] >>> (feature & 31)) & 1) === 1;
+}
+
+module.exports.logicalCPUs = function() {
+	return cpuid.getLogicalCPUs();
+}
+
+module.exports.topology = function() {
+	return cpuid.getTopology();
+}
+
+module.exports.cacheTopology = function() {
+	return cpuid.getCacheTopology();
+}
+
+var tscTimer;
+
+module.exports.tscTimer = function() {
+	if (!tscTimer) {
+		var calibration = cpuid.calibrateTSC();
+		var nsPerTick = calibration.nsPerTick;
+		var now = calibration.readTSC;
+
+		tscTimer = Object.freeze({
+			frequency: calibration.frequency,
+			frequencyError: calibration.frequencyError,
+			nsPerTick: nsPerTick,
+			rdtscp: calibration.rdtscp,
+			now: now,
+			nowOrdered: calibration.rdtscp ? calibration.readTSCP : now,
+			toNanoseconds: function(ticks) {
+				return ticks * nsPerTick;
+			},
+			elapsedNs: function(startTicks) {
+				return (now() - startTicks) * nsPerTick;
+			}
+		});
+	}
+
+	return tscTimer;
+}
+
+module.exports.measureClock = function(options) {
+	options = options || {};
+	var tolerance = options.tolerance !== undefined ? options.tolerance : 0.001;
+	var budget = options.budget !== undefined ? options.budget : 200;
+	return cpuid.measureClock(tolerance, budget);
+}
+
+module.exports.effectiveCpus = function(options) {
+	options = options || {};
+	return cpuid.getEffectiveCPUs(options.procfsRoot, options.cgroupRoot);
+}
+
+module.exports.cpuPressure = function(options) {
+	options = options || {};
+	var interval = options.interval !== undefined ? options.interval : 1000;
+	var emitter = new EventEmitter();
+	var monitor = cpuid.createPressureMonitor(interval, options.procfsRoot, options.cgroupRoot, function(event, stats) {
+		emitter.emit(event, stats);
+	});
+
+	emitter.stats = monitor.stats;
+	emitter.stop = monitor.stop;
+	return emitter;
+}
+
+module.exports.msrCPUs = function() {
+	return cpuid.getMSRCPUs();
+}
+
+// MSR values are 64-bit, more than a double holds exactly
+module.exports.readMSR = function(cpu, msr) {
+	var value = cpuid.readMSR(cpu, msr);
+	if (typeof BigInt === 'function') {
+		return (BigInt(value[1]) << BigInt(32)) | BigInt(value[0]);
+	}
+	return value;
+}
+
+module.exports.readMSRs = function(pairs, out, options, callback) {
+	if (typeof options === 'function') {
+		callback = options;
+		options = undefined;
+	}
+	var threads = (options && options.threads) || 0;
+	out = out || new Uint32Array(pairs.length);
+
+	if (typeof callback === 'function') {
+		return cpuid.readMSRs(pairs, out, threads, function(err, failed) {
+			callback(err, out, failed);
+		});
+	}
+
+	return new Promise(function(resolve, reject) {
+		cpuid.readMSRs(pairs, out, threads, function(err, failed) {
+			if (err) {
+				return reject(err);
+			}
+			resolve({ values: out, failed: failed });
+		});
+	});
+}
+
+module.exports.thermal = function(options, callback) {
+	if (typeof options === 'function') {
+		callback = options;
+		options = undefined;
+	}
+	var root = options && options.sysfsRoot;
+
+	if (typeof callback === 'function') {
+		return cpuid.getThermal(root, callback);
+	}
+
+	return new Promise(function(resolve, reject) {
+		cpuid.getThermal(root, function(err, data) {
+			if (err) {
+				return reject(err);
+			}
+			resolve(data);
+		});
+	});
+}
+
+module.exports.energySampler = function(options) {
+	var sysfsRoot = options && options.sysfsRoot;
+	return cpuid.createEnergySampler(sysfsRoot);
+}
+
+module.exports.frequencySampler = function(options) {
+	options = options || {};
+	var interval = options.interval !== undefined ? options.interval : 100;
+	return cpuid.createFrequencySampler(interval, options.sysfsRoot);
+}
+
+// The column order of src/cputimes.cc
+var CPU_TIMES_FIELDS = ['user', 'nice', 'sys', 'idle', 'irq', 'steal', 'iowait', 'softirq', 'speed'];
+
+function cpuTimes(options) {
+	var reader = cpuid.createCPUTimesReader(options.procfsRoot, options.sysfsRoot);
+	var count = reader.cpus;
+	var columns = new Float64Array(count * reader.columns);
+	// The first call probes the CPU, unless getCPUID() already has
+	var cpu = cpuid.getCPUID();
+	var nominal = cpu.clockSpeed;
+	var data = {
+		model: cpu.brand,
+		count: count,
+		utilization: new Float64Array(count).fill(-1)
+	};
+	CPU_TIMES_FIELDS.forEach(function(field, i) {
+		data[field] = columns.subarray(i * count, (i + 1) * count);
+	});
+
+	data.refresh = function(delta) {
+		reader.read(columns, delta ? data.utilization : undefined);
+		if (nominal > 0) {
+			for (var cpu = 0; cpu < count; cpu++) {
+				if (data.speed[cpu] < 0 && data.idle[cpu] >= 0) {
+					data.speed[cpu] = nominal;
+				}
+			}
+		}
+		return data;
+	};
+	return data;
+}
+
+// One reader per procfs and sysfs root, so that delta mode spans calls
+var cpuTimesReaders = {};
+
+module.exports.cpus = function(options) {
+	options = options || {};
+	var key = (options.procfsRoot || '') + '\0' + (options.sysfsRoot || '');
+	if (!cpuTimesReaders[key]) {
+		cpuTimesReaders[key] = cpuTimes(options);
+	}
+	return cpuTimesReaders[key].refresh(options.delta);
+}
+
+// Mirrors the layout in src/telemetry.cc
+var TELEMETRY_HEADER_BYTES = 32;
+var TELEMETRY_MHZ = 0;
+var TELEMETRY_TEMPERATURE = 1;
+var TELEMETRY_THROTTLING = 2;
+var TELEMETRY_UTILIZATION = 3;
+
+function telemetryView(buffer) {
+	var header = new Int32Array(buffer, 0, TELEMETRY_HEADER_BYTES >> 2);
+	var sampledAt = new Float64Array(buffer, 24, 1);
+	var cpus = header[2];
+	var stride = header[3];
+	var values = new Float64Array(buffer, TELEMETRY_HEADER_BYTES, cpus * stride);
+
+	function snapshot() {
+		return {
+			generation: 0,
+			sampledAt: 0,
+			mhz: new Float64Array(cpus),
+			temperature: new Float64Array(cpus),
+			throttling: new Float64Array(cpus),
+			utilization: new Float64Array(cpus)
+		};
+	}
+
+	return Object.freeze({
+		buffer: buffer,
+		cpus: cpus,
+		interval: header[4],
+		generation: function() {
+			return Atomics.load(header, 1);
+		},
+		read: function(out) {
+			out = out || snapshot();
+			for (;;) {
+				var seq = Atomics.load(header, 0);
+				if (seq & 1) {
+					continue;
+				}
+				for (var cpu = 0, i = 0; cpu < cpus; cpu++, i += stride) {
+					out.mhz[cpu] = values[i + TELEMETRY_MHZ];
+					out.temperature[cpu] = values[i + TELEMETRY_TEMPERATURE];
+					out.throttling[cpu] = values[i + TELEMETRY_THROTTLING];
+					out.utilization[cpu] = values[i + TELEMETRY_UTILIZATION];
+				}
+				out.sampledAt = sampledAt[0];
+				out.generation = Atomics.load(header, 1);
+				if (Atomics.load(header, 0) === seq) {
+					return out;
+				}
+			}
+		}
+	});
+}
+
+var telemetry;
+
+module.exports.telemetry = function(options) {
+	if (!telemetry) {
+		var interval = options && options.interval !== undefined ? options.interval : 500;
+		telemetry = telemetryView(cpuid.getTelemetryBuffer(interval));
+	}
+	return telemetry;
+}
+
+function turboTable(table) {
+	table.forCores = function(activeCores) {
+		if (table.turboEnabled === false) {
+			return table.baseMHz;
+		}
+		// Entries are upper bounds of core-count groups, in ascending order
+		for (var i = 0; i < table.entries.length; i++) {
+			if (activeCores <= table.entries[i].activeCores) {
+				return table.entries[i].mhz;
+			}
+		}
+		// Beyond the table, the last (all-core) group applies
+		return table.entries.length ? table.entries[table.entries.length - 1].mhz : -1;
+	};
+	return table;
+}
+
+module.exports.turboTable = function(options, callback) {
+	if (typeof options === 'function') {
+		callback = options;
+		options = undefined;
+	}
+	var measure = !!(options && options.measure);
+
+	if (typeof callback === 'function') {
+		return cpuid.getTurboTable(measure, function(err, table) {
+			callback(err, table && turboTable(table));
+		});
+	}
+
+	return new Promise(function(resolve, reject) {
+		cpuid.getTurboTable(measure, function(err, table) {
+			if (err) {
+				return reject(err);
+			}
+			resolve(turboTable(table));
+		});
+	});
+}
+
+module.exports.perfLevels = function(options, callback) {
+	if (typeof options === 'function') {
+		callback = options;
+		options = undefined;
+	}
+	var root = options && options.sysfsRoot;
+
+	if (typeof callback === 'function') {
+		return cpuid.getPerfLevels(root, callback);
+	}
+
+	return new Promise(function(resolve, reject) {
+		cpuid.getPerfLevels(root, function(err, cpus) {
+			if (err) {
+				return reject(err);
+			}
+			resolve(cpus);
+		});
+	});
+}
+
+module.exports.getCPUIDAsync = function(callback) {
+	if (typeof callback === 'function') {
+		return cpuid.getCPUIDAsync(callback);
+	}
+
+	return new Promise(function(resolve, reject) {
+		cpuid.getCPUIDAsync(function(err, data) {
+			if (err) {
+				return reject(err);
+			}
+			resolve(data);
+		});
+	});
+}
@@ -0,0 +1,41 @@
+#ifndef CPUID_ADDON_H
+#define CPUID_ADDON_H
+
+#include <nan.h>
+
+/*
+ * Each group of bindings lives in its own source file and registers its
+ * methods on the module object from InitAll().
+ */
+NAN_MODULE_INIT(InitTimer);
+NAN_MODULE_INIT(InitMSR);
+NAN_MODULE_INIT(InitThermal);
+NAN_MODULE_INIT(InitPower);
+NAN_MODULE_INIT(InitTurbo);
+NAN_MODULE_INIT(InitHWP);
+NAN_MODULE_INIT(InitFrequency);
+NAN_MODULE_INIT(InitTelemetry);
+NAN_MODULE_INIT(InitCPUTimes);
+NAN_MODULE_INIT(InitCgroup);
+
+// A fixture sysfs root may describe more CPUs than this machine has
+#define FIXTURE_MAX_CPUS 256
+
+struct msr_cpu_set_t;
+
+/*
+ * The process-wide MSR handles of all online CPUs, opened on first use.
+ * Returns NULL, and the reason in error, if they cannot be opened.
+ */
+msr_cpu_set_t* sharedMSRSet(const char** error);
+
+struct cpu_freq_sampler_t;
+struct cpu_times_reader_t;
+
+/*
+ * One more than the highest CPU number that libuv, the frequency sampler or
+ * /proc/stat knows of; either of the latter may be NULL.
+ */
+int countCPUs(cpu_freq_sampler_t* freq, cpu_times_reader_t* times);
+
+#endif
@@ -0,0 +1,366 @@
+#include "addon.h"
+#include <libcpuid.h>
+#include <deque>
+#include <string>
+#include <vector>
+
+using namespace v8;
+
+static Local<Value> limitValue(double value) {
+	if(value < 0) {
+		return Nan::Null();
+	}
+	return Nan::New<Number>(value);
+}
+
+// Explicit procfs and cgroup roots read a test fixture instead
+NAN_METHOD(GetEffectiveCPUs) {
+	std::string procRoot, cgroupRoot;
+	if(info[0]->IsString()) {
+		procRoot = *Nan::Utf8String(info[0]);
+	}
+	if(info[1]->IsString()) {
+		cgroupRoot = *Nan::Utf8String(info[1]);
+	}
+
+	// Too large for the stack of a JS thread
+	cpu_effective_t* eff = new cpu_effective_t();
+	if(cpu_effective_cpus(procRoot.empty() ? NULL : procRoot.c_str(), cgroupRoot.empty() ? NULL : cgroupRoot.c_str(), eff) < 0) {
+		delete eff;
+		return Nan::ThrowError(cpuid_error());
+	}
+
+	Local<Array> cpus = Nan::New<Array>(eff->num_cpus);
+	for(int i = 0; i < eff->num_cpus; i++) {
+		cpus->Set(i, Nan::New(eff->cpus[i]));
+	}
+
+	Local<Object> data = Nan::New<Object>();
+	data->Set(Nan::New("cpus").ToLocalChecked(), cpus);
+	data->Set(Nan::New("quota").ToLocalChecked(), limitValue(eff->quota));
+	data->Set(Nan::New("quotaMicros").ToLocalChecked(), limitValue(static_cast<double>(eff->quota_us)));
+	data->Set(Nan::New("periodMicros").ToLocalChecked(), limitValue(static_cast<double>(eff->period_us)));
+	data->Set(Nan::New("parallelism").ToLocalChecked(), Nan::New(eff->parallelism));
+	data->Set(Nan::New("onlineCPUs").ToLocalChecked(), Nan::New(eff->online_cpus));
+	data->Set(Nan::New("cgroupVersion").ToLocalChecked(), eff->cgroup_version ? Local<Value>(Nan::New(eff->cgroup_version)) : Local<Value>(Nan::Null()));
+	delete eff;
+	info.GetReturnValue().Set(data);
+}
+
+// The windows of the rolling rates, in seconds
+static const int pressureWindows[] = { 10, 60 };
+#define PRESSURE_HISTORY_US (60 * 1000000ULL)
+
+/*
+ * A pressure monitor reads cpu.stat and the PSI counters on its own thread,
+ * keeps a minute of readings for the rolling rates, and wakes the JS thread
+ * through a uv_async_t when throttling starts or ends.
+ *
+ * It lives until it has been stopped and both its stats() and stop()
+ * functions have been collected; until stopped, its callback keeps firing
+ * even if nothing else refers to it, like a timer. Stopping drops the
+ * callback, so that whatever it refers to can be collected too, and the
+ * exit of its environment (e.g. a worker) stops it.
+ */
+struct PressureMonitor {
+	cpu_pressure_reader_t* reader;
+	uint64_t intervalNs;
+
+	uv_thread_t thread;
+	uv_mutex_t lock;
+	uv_cond_t wake;
+	uv_async_t async;
+	bool running;
+	bool stopping;
+
+	// Guarded by lock
+	std::deque<cpu_pressure_t> history;
+	bool throttling;
+	std::vector<bool> events;
+
+	Nan::Callback* callback;
+	Nan::AsyncResource* resource;
+	Isolate* isolate;
+	bool cleanupHook;
+	int refs;
+	Nan::Persistent<Function> stats;
+	Nan::Persistent<Function> stop;
+};
+
+static void monitorPressure(void* arg) {
+	PressureMonitor* monitor = static_cast<PressureMonitor*>(arg);
+	cpu_pressure_t counters;
+
+	uv_mutex_lock(&monitor->lock);
+	while(!monitor->stopping) {
+		uv_mutex_unlock(&monitor->lock);
+		bool read = cpu_pressure_read(monitor->reader, &counters) == 0;
+		uv_mutex_lock(&monitor->lock);
+
+		if(read) {
+			// Throttled since the previous reading, by either counter
+			if(!monitor->history.empty()) {
+				const cpu_pressure_t& last = monitor->history.back();
+				bool throttled = counters.nr_throttled > last.nr_throttled || counters.throttled_us > last.throttled_us;
+				if(throttled != monitor->throttling) {
+					monitor->throttling = throttled;
+					monitor->events.push_back(throttled);
+					uv_async_send(&monitor->async);
+				}
+			}
+
+			monitor->history.push_back(counters);
+			while(monitor->history.size() > 2 &&
+				counters.timestamp_us - monitor->history[1].timestamp_us >= PRESSURE_HISTORY_US) {
+				monitor->history.pop_front();
+			}
+		}
+
+		if(!monitor->stopping) {
+			uv_cond_timedwait(&monitor->wake, &monitor->lock, monitor->intervalNs);
+		}
+	}
+	uv_mutex_unlock(&monitor->lock);
+}
+
+static Local<Value> rateValue(double value) {
+	if(value < 0) {
+		return Nan::Null();
+	}
+	return Nan::New<Number>(value);
+}
+
+static Local<Value> counterValue(int64_t value) {
+	if(value < 0) {
+		return Nan::Null();
+	}
+	return Nan::New<Number>(static_cast<double>(value));
+}
+
+// Must be called with the lock held
+static Local<Object> buildPressureStats(PressureMonitor* monitor) {
+	Local<Object> data = Nan::New<Object>();
+	data->Set(Nan::New("throttling").ToLocalChecked(), Nan::New<Boolean>(monitor->throttling));
+	if(monitor->history.empty()) {
+		return data;
+	}
+
+	const cpu_pressure_t& last = monitor->history.back();
+	Local<Object> counters = Nan::New<Object>();
+	counters->Set(Nan::New("usageMicros").ToLocalChecked(), counterValue(last.usage_us));
+	counters->Set(Nan::New("periods").ToLocalChecked(), counterValue(last.nr_periods));
+	counters->Set(Nan::New("throttledPeriods").ToLocalChecked(), counterValue(last.nr_throttled));
+	counters->Set(Nan::New("throttledMicros").ToLocalChecked(), counterValue(last.throttled_us));
+	counters->Set(Nan::New("someAvg10").ToLocalChecked(), rateValue(last.some_avg10));
+	counters->Set(Nan::New("someAvg60").ToLocalChecked(), rateValue(last.some_avg60));
+	counters->Set(Nan::New("someAvg300").ToLocalChecked(), rateValue(last.some_avg300));
+	counters->Set(Nan::New("fullAvg10").ToLocalChecked(), rateValue(last.full_avg10));
+	counters->Set(Nan::New("fullAvg60").ToLocalChecked(), rateValue(last.full_avg60));
+	counters->Set(Nan::New("fullAvg300").ToLocalChecked(), rateValue(last.full_avg300));
+	data->Set(Nan::New("counters").ToLocalChecked(), counters);
+
+	for(size_t w = 0; w < sizeof(pressureWindows) / sizeof(pressureWindows[0]); w++) {
+		// The oldest reading inside the window, or just outside it if none is
+		size_t first = monitor->history.size() - 1;
+		uint64_t window = static_cast<uint64_t>(pressureWindows[w]) * 1000000;
+		while(first > 0 && last.timestamp_us - monitor->history[first].timestamp_us < window) {
+			first--;
+		}
+
+		cpu_pressure_rates_t rates;
+		Local<Value> value = Nan::Null();
+		if(cpu_pressure_rates(&monitor->history[first], &last, &rates) == 0) {
+			Local<Object> r = Nan::New<Object>();
+			r->Set(Nan::New("seconds").ToLocalChecked(), Nan::New<Number>(rates.seconds));
+			r->Set(Nan::New("usage").ToLocalChecked(), rateValue(rates.usage));
+			r->Set(Nan::New("throttled").ToLocalChecked(), rateValue(rates.throttled));
+			r->Set(Nan::New("throttledPeriods").ToLocalChecked(), rateValue(rates.throttled_periods));
+			r->Set(Nan::New("some").ToLocalChecked(), rateValue(rates.some));
+			r->Set(Nan::New("full").ToLocalChecked(), rateValue(rates.full));
+			value = r;
+		}
+		std::string key = "last" + std::to_string(pressureWindows[w]) + "s";
+		data->Set(Nan::New(key).ToLocalChecked(), value);
+	}
+	return data;
+}
+
+static void deliverPressureEvents(uv_async_t* handle) {
+	PressureMonitor* monitor = static_cast<PressureMonitor*>(handle->data);
+	Nan::HandleScope scope;
+
+	uv_mutex_lock(&monitor->lock);
+	std::vector<bool> events;
+	events.swap(monitor->events);
+	Local<Object> stats = buildPressureStats(monitor);
+	uv_mutex_unlock(&monitor->lock);
+
+	// A listener may stop the monitor, which drops the callback
+	for(size_t i = 0; i < events.size() && monitor->callback; i++) {
+		Local<Value> argv[] = { Nan::New(events[i] ? "throttled" : "recovered").ToLocalChecked(), stats };
+		monitor->callback->Call(2, argv, monitor->resource);
+	}
+}
+
+#if NODE_MODULE_VERSION >= NODE_10_0_MODULE_VERSION
+static void cleanupPressureMonitor(void* arg);
+#endif
+
+static void releasePressureMonitor(PressureMonitor* monitor) {
+	if(--monitor->refs > 0) {
+		return;
+	}
+
+#if NODE_MODULE_VERSION >= NODE_10_0_MODULE_VERSION
+	if(monitor->cleanupHook) {
+		node::RemoveEnvironmentCleanupHook(monitor->isolate, cleanupPressureMonitor, monitor);
+	}
+#endif
+	cpu_pressure_close(monitor->reader);
+	uv_cond_destroy(&monitor->wake);
+	uv_mutex_destroy(&monitor->lock);
+	delete monitor->callback;
+	delete monitor->resource;
+	delete monitor;
+}
+
+static void closePressureAsync(uv_handle_t* handle) {
+	releasePressureMonitor(static_cast<PressureMonitor*>(handle->data));
+}
+
+static void releasePressureStats(const Nan::WeakCallbackInfo<PressureMonitor>& info) {
+	PressureMonitor* monitor = info.GetParameter();
+	monitor->stats.Reset();
+	releasePressureMonitor(monitor);
+}
+
+static void releasePressureStop(const Nan::WeakCallbackInfo<PressureMonitor>& info) {
+	PressureMonitor* monitor = info.GetParameter();
+	monitor->stop.Reset();
+	releasePressureMonitor(monitor);
+}
+
+// Joins the thread and closes the async handle, which gives up the running reference
+static void stopPressureThread(PressureMonitor* monitor) {
+	if(!monitor->running) {
+		return;
+	}
+
+	uv_mutex_lock(&monitor->lock);
+	monitor->stopping = true;
+	uv_cond_signal(&monitor->wake);
+	uv_mutex_unlock(&monitor->lock);
+	uv_thread_join(&monitor->thread);
+	monitor->running = false;
+
+	// No more events: let go of the callback and what its closure holds
+	delete monitor->callback;
+	monitor->callback = NULL;
+	delete monitor->resource;
+	monitor->resource = NULL;
+	uv_close(reinterpret_cast<uv_handle_t*>(&monitor->async), closePressureAsync);
+}
+
+#if NODE_MODULE_VERSION >= NODE_10_0_MODULE_VERSION
+// The environment exits before stop() was called, or the functions were
+// collected; weak callbacks do not run after this
+static void cleanupPressureMonitor(void* arg) {
+	PressureMonitor* monitor = static_cast<PressureMonitor*>(arg);
+	monitor->cleanupHook = false;
+	stopPressureThread(monitor);
+	if(!monitor->stats.IsEmpty()) {
+		monitor->stats.Reset();
+		releasePressureMonitor(monitor);
+	}
+	if(!monitor->stop.IsEmpty()) {
+		monitor->stop.Reset();
+		releasePressureMonitor(monitor);
+	}
+}
+#endif
+
+NAN_METHOD(GetPressureStats) {
+	PressureMonitor* monitor = static_cast<PressureMonitor*>(info.Data().As<External>()->Value());
+	uv_mutex_lock(&monitor->lock);
+	Local<Object> stats = buildPressureStats(monitor);
+	uv_mutex_unlock(&monitor->lock);
+	info.GetReturnValue().Set(stats);
+}
+
+NAN_METHOD(StopPressureMonitor) {
+	PressureMonitor* monitor = static_cast<PressureMonitor*>(info.Data().As<External>()->Value());
+	stopPressureThread(monitor);
+}
+
+// Explicit procfs and cgroup roots read a test fixture instead
+NAN_METHOD(CreatePressureMonitor) {
+	if(!info[0]->IsUint32()) {
+		return Nan::ThrowTypeError("Interval must be an unsigned integer");
+	}
+	if(!info[3]->IsFunction()) {
+		return Nan::ThrowTypeError("Callback must be a function");
+	}
+
+	std::string procRoot, cgroupRoot;
+	if(info[1]->IsString()) {
+		procRoot = *Nan::Utf8String(info[1]);
+	}
+	if(info[2]->IsString()) {
+		cgroupRoot = *Nan::Utf8String(info[2]);
+	}
+
+	cpu_pressure_reader_t* reader = cpu_pressure_open(procRoot.empty() ? NULL : procRoot.c_str(), cgroupRoot.empty() ? NULL : cgroupRoot.c_str());
+	if(!reader) {
+		return Nan::ThrowError(cpuid_error());
+	}
+
+	uint32_t interval = Nan::To<uint32_t>(info[0]).FromJust();
+	PressureMonitor* monitor = new PressureMonitor();
+	monitor->reader = reader;
+	monitor->intervalNs = static_cast<uint64_t>(interval > 0 ? interval : 1) * 1000000;
+	monitor->running = false;
+	monitor->stopping = false;
+	monitor->throttling = false;
+	monitor->callback = new Nan::Callback(info[3].As<Function>());
+	monitor->resource = new Nan::AsyncResource("cpuid:PressureMonitor");
+	monitor->isolate = Isolate::GetCurrent();
+	monitor->cleanupHook = false;
+	uv_mutex_init(&monitor->lock);
+	uv_cond_init(&monitor->wake);
+
+	// The running thread holds the third reference, given up by stop()
+	monitor->refs = 3;
+	uv_async_init(Nan::GetCurrentEventLoop(), &monitor->async, deliverPressureEvents);
+	monitor->async.data = monitor;
+	uv_unref(reinterpret_cast<uv_handle_t*>(&monitor->async));
+	if(uv_thread_create(&monitor->thread, monitorPressure, monitor) != 0) {
+		monitor->refs = 1;
+		uv_close(reinterpret_cast<uv_handle_t*>(&monitor->async), closePressureAsync);
+		return Nan::ThrowError("Cannot start the monitor thread");
+	}
+	monitor->running = true;
+#if NODE_MODULE_VERSION >= NODE_10_0_MODULE_VERSION
+	node::AddEnvironmentCleanupHook(monitor->isolate, cleanupPressureMonitor, monitor);
+	monitor->cleanupHook = true;
+#endif
+
+	Local<Function> stats = Nan::GetFunction(Nan::New<FunctionTemplate>(GetPressureStats, Nan::New<External>(monitor))).ToLocalChecked();
+	monitor->stats.Reset(stats);
+	monitor->stats.SetWeak(monitor, releasePressureStats, Nan::WeakCallbackType::kParameter);
+
+	Local<Function> stop = Nan::GetFunction(Nan::New<FunctionTemplate>(StopPressureMonitor, Nan::New<External>(monitor))).ToLocalChecked();
+	monitor->stop.Reset(stop);
+	monitor->stop.SetWeak(monitor, releasePressureStop, Nan::WeakCallbackType::kParameter);
+
+	Local<Object> data = Nan::New<Object>();
+	data->Set(Nan::New("stats").ToLocalChecked(), stats);
+	data->Set(Nan::New("stop").ToLocalChecked(), stop);
+	info.GetReturnValue().Set(data);
+}
+
+NAN_MODULE_INIT(InitCgroup) {
+	Nan::Set(target, Nan::New("getEffectiveCPUs").ToLocalChecked(),
+		Nan::GetFunction(Nan::New<FunctionTemplate>(GetEffectiveCPUs)).ToLocalChecked());
+	Nan::Set(target, Nan::New("createPressureMonitor").ToLocalChecked(),
+		Nan::GetFunction(Nan::New<FunctionTemplate>(CreatePressureMonitor)).ToLocalChecked());
+}
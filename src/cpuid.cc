@@ -1,8 +1,93 @@
-#include <nan.h>
+#include "addon.h"
 #include <libcpuid.h>
+#include <ctype.h>
+#include <string.h>
+#include <string>
 
 using namespace v8;
 
+/*
+ * Identification data is probed once per process, either by the first
+ * getCPUID() call or off the main thread by getCPUIDAsync(), and then shared
+ * by every caller, including other worker threads; refresh() re-probes on
+ * demand. The shared state below is only accessed under SharedLock.
+ */
+struct CPUIDSnapshot {
+	CPUIDSnapshot() : probed(false), error(NULL), clock(-1) {
+		memset(&clockInfo, 0, sizeof(clockInfo));
+		clockInfo.base_mhz = clockInfo.max_mhz = clockInfo.bus_mhz = -1;
+	}
+
+	bool probed;
+	const char* error;
+	cpu_raw_data_t raw;
+	cpu_id_t id;
+	int clock;
+	cpu_clock_info_t clockInfo;
+};
+
+static CPUIDSnapshot snapshot;
+static unsigned snapshotGeneration = 0;
+
+/*
+ * Raw CPUID data of every logical CPU, collected by getLogicalCPUs() on first
+ * use and dropped again by refresh().
+ */
+struct LogicalCPUsSnapshot {
+	LogicalCPUsSnapshot() : probed(false), error(NULL) {
+		raw.num_raw = 0;
+		raw.cpus = NULL;
+	}
+
+	bool probed;
+	const char* error;
+	cpu_raw_data_array_t raw;
+};
+
+static LogicalCPUsSnapshot logicalCPUs;
+static unsigned logicalCPUsGeneration = 0;
+
+static uv_once_t sharedLockOnce = UV_ONCE_INIT;
+static uv_mutex_t sharedLock;
+
+static void initSharedLock() {
+	uv_mutex_init(&sharedLock);
+}
+
+class SharedLock {
+public:
+	SharedLock() {
+		uv_once(&sharedLockOnce, initSharedLock);
+		uv_mutex_lock(&sharedLock);
+	}
+
+	~SharedLock() {
+		uv_mutex_unlock(&sharedLock);
+	}
+};
+
+/*
+ * Per-instance state. With worker_threads the addon is initialized once per
+ * thread, and V8 handles cannot be shared between isolates, so every
+ * instance builds its own result objects from the shared data. They are
+ * rebuilt whenever the shared data's generation moves on.
+ */
+struct AddonData {
+	AddonData() : snapshotGeneration(0), logicalCPUsGeneration(0) {}
+
+	Nan::Persistent<Object> snapshotObject;
+	unsigned snapshotGeneration;
+
+	Nan::Persistent<Array> logicalCPUsObject;
+	Nan::Persistent<Object> topologyObject;
+	Nan::Persistent<Array> cacheTopologyObject;
+	unsigned logicalCPUsGeneration;
+};
+
+static AddonData* getAddonData(const Nan::FunctionCallbackInfo<Value>& info) {
+	return static_cast<AddonData*>(info.Data().As<External>()->Value());
+}
+
 static const char* mapVendor(cpu_vendor_t vendor) {
 	switch(vendor) {
 		case VENDOR_INTEL:
@@ -40,6 +125,10 @@ static const char* mapVendor(cpu_vendor_t vendor) {
 	}
 }
 
+static Local<Object> freezeObject(Local<Object> obj) {
+	obj->SetIntegrityLevel(Nan::GetCurrentContext(), IntegrityLevel::kFrozen);
+	return obj;
+}
 
 static void fillFeatures(Handle<Object> features, cpu_id_t& cpuData) {
 	features->Set(Nan::New("fpu").ToLocalChecked(), Nan::New(cpuData.flags[CPU_FEATURE_FPU]));
@@ -127,6 +216,66 @@ static void fillFeatures(Handle<Object> features, cpu_id_t& cpuData) {
 	features->Set(Nan::New("multiplierSteps100mhz").ToLocalChecked(), Nan::New(cpuData.flags[CPU_FEATURE_100MHZSTEPS]));
 	features->Set(Nan::New("hardwarePState").ToLocalChecked(), Nan::New(cpuData.flags[CPU_FEATURE_HWPSTATE]));
 	features->Set(Nan::New("constantTSCTicks").ToLocalChecked(), Nan::New(cpuData.flags[CPU_FEATURE_CONSTANT_TSC]));
+	features->Set(Nan::New("fsgsbase").ToLocalChecked(), Nan::New(cpuData.flags[CPU_FEATURE_FSGSBASE]));
+	features->Set(Nan::New("bmi1").ToLocalChecked(), Nan::New(cpuData.flags[CPU_FEATURE_BMI1]));
+	features->Set(Nan::New("hle").ToLocalChecked(), Nan::New(cpuData.flags[CPU_FEATURE_HLE]));
+	features->Set(Nan::New("avx2").ToLocalChecked(), Nan::New(cpuData.flags[CPU_FEATURE_AVX2]));
+	features->Set(Nan::New("smep").ToLocalChecked(), Nan::New(cpuData.flags[CPU_FEATURE_SMEP]));
+	features->Set(Nan::New("bmi2").ToLocalChecked(), Nan::New(cpuData.flags[CPU_FEATURE_BMI2]));
+	features->Set(Nan::New("enhancedRepMovsb").ToLocalChecked(), Nan::New(cpuData.flags[CPU_FEATURE_ERMS]));
+	features->Set(Nan::New("invpcid").ToLocalChecked(), Nan::New(cpuData.flags[CPU_FEATURE_INVPCID]));
+	features->Set(Nan::New("rtm").ToLocalChecked(), Nan::New(cpuData.flags[CPU_FEATURE_RTM]));
+	features->Set(Nan::New("avx512f").ToLocalChecked(), Nan::New(cpuData.flags[CPU_FEATURE_AVX512F]));
+	features->Set(Nan::New("avx512dq").ToLocalChecked(), Nan::New(cpuData.flags[CPU_FEATURE_AVX512DQ]));
+	features->Set(Nan::New("rdseed").ToLocalChecked(), Nan::New(cpuData.flags[CPU_FEATURE_RDSEED]));
+	features->Set(Nan::New("adx").ToLocalChecked(), Nan::New(cpuData.flags[CPU_FEATURE_ADX]));
+	features->Set(Nan::New("smap").ToLocalChecked(), Nan::New(cpuData.flags[CPU_FEATURE_SMAP]));
+	features->Set(Nan::New("avx512ifma").ToLocalChecked(), Nan::New(cpuData.flags[CPU_FEATURE_AVX512IFMA]));
+	features->Set(Nan::New("clflushopt").ToLocalChecked(), Nan::New(cpuData.flags[CPU_FEATURE_CLFLUSHOPT]));
+	features->Set(Nan::New("clwb").ToLocalChecked(), Nan::New(cpuData.flags[CPU_FEATURE_CLWB]));
+	features->Set(Nan::New("avx512pf").ToLocalChecked(), Nan::New(cpuData.flags[CPU_FEATURE_AVX512PF]));
+	features->Set(Nan::New("avx512er").ToLocalChecked(), Nan::New(cpuData.flags[CPU_FEATURE_AVX512ER]));
+	features->Set(Nan::New("avx512cd").ToLocalChecked(), Nan::New(cpuData.flags[CPU_FEATURE_AVX512CD]));
+	features->Set(Nan::New("sha").ToLocalChecked(), Nan::New(cpuData.flags[CPU_FEATURE_SHA_NI]));
+	features->Set(Nan::New("avx512bw").ToLocalChecked(), Nan::New(cpuData.flags[CPU_FEATURE_AVX512BW]));
+	features->Set(Nan::New("avx512vl").ToLocalChecked(), Nan::New(cpuData.flags[CPU_FEATURE_AVX512VL]));
+	features->Set(Nan::New("avx512vbmi").ToLocalChecked(), Nan::New(cpuData.flags[CPU_FEATURE_AVX512VBMI]));
+	features->Set(Nan::New("umip").ToLocalChecked(), Nan::New(cpuData.flags[CPU_FEATURE_UMIP]));
+	features->Set(Nan::New("pku").ToLocalChecked(), Nan::New(cpuData.flags[CPU_FEATURE_PKU]));
+	features->Set(Nan::New("waitpkg").ToLocalChecked(), Nan::New(cpuData.flags[CPU_FEATURE_WAITPKG]));
+	features->Set(Nan::New("avx512vbmi2").ToLocalChecked(), Nan::New(cpuData.flags[CPU_FEATURE_AVX512VBMI2]));
+	features->Set(Nan::New("gfni").ToLocalChecked(), Nan::New(cpuData.flags[CPU_FEATURE_GFNI]));
+	features->Set(Nan::New("vaes").ToLocalChecked(), Nan::New(cpuData.flags[CPU_FEATURE_VAES]));
+	features->Set(Nan::New("vpclmulqdq").ToLocalChecked(), Nan::New(cpuData.flags[CPU_FEATURE_VPCLMULQDQ]));
+	features->Set(Nan::New("avx512vnni").ToLocalChecked(), Nan::New(cpuData.flags[CPU_FEATURE_AVX512VNNI]));
+	features->Set(Nan::New("avx512bitalg").ToLocalChecked(), Nan::New(cpuData.flags[CPU_FEATURE_AVX512BITALG]));
+	features->Set(Nan::New("avx512vpopcntdq").ToLocalChecked(), Nan::New(cpuData.flags[CPU_FEATURE_AVX512VPOPCNTDQ]));
+	features->Set(Nan::New("rdpid").ToLocalChecked(), Nan::New(cpuData.flags[CPU_FEATURE_RDPID]));
+	features->Set(Nan::New("movdiri").ToLocalChecked(), Nan::New(cpuData.flags[CPU_FEATURE_MOVDIRI]));
+	features->Set(Nan::New("movdir64b").ToLocalChecked(), Nan::New(cpuData.flags[CPU_FEATURE_MOVDIR64B]));
+	features->Set(Nan::New("fastShortRepMovsb").ToLocalChecked(), Nan::New(cpuData.flags[CPU_FEATURE_FSRM]));
+	features->Set(Nan::New("avx512vp2intersect").ToLocalChecked(), Nan::New(cpuData.flags[CPU_FEATURE_AVX512VP2INTERSECT]));
+	features->Set(Nan::New("mdClear").ToLocalChecked(), Nan::New(cpuData.flags[CPU_FEATURE_MD_CLEAR]));
+	features->Set(Nan::New("serialize").ToLocalChecked(), Nan::New(cpuData.flags[CPU_FEATURE_SERIALIZE]));
+	features->Set(Nan::New("hybrid").ToLocalChecked(), Nan::New(cpuData.flags[CPU_FEATURE_HYBRID]));
+	features->Set(Nan::New("amxBf16").ToLocalChecked(), Nan::New(cpuData.flags[CPU_FEATURE_AMX_BF16]));
+	features->Set(Nan::New("avx512fp16").ToLocalChecked(), Nan::New(cpuData.flags[CPU_FEATURE_AVX512FP16]));
+	features->Set(Nan::New("amxTile").ToLocalChecked(), Nan::New(cpuData.flags[CPU_FEATURE_AMX_TILE]));
+	features->Set(Nan::New("amxInt8").ToLocalChecked(), Nan::New(cpuData.flags[CPU_FEATURE_AMX_INT8]));
+	features->Set(Nan::New("avxVnni").ToLocalChecked(), Nan::New(cpuData.flags[CPU_FEATURE_AVX_VNNI]));
+	features->Set(Nan::New("avx512bf16").ToLocalChecked(), Nan::New(cpuData.flags[CPU_FEATURE_AVX512BF16]));
+	features->Set(Nan::New("fastZeroLengthRepMovsb").ToLocalChecked(), Nan::New(cpuData.flags[CPU_FEATURE_FZLRM]));
+	features->Set(Nan::New("fastShortRepStosb").ToLocalChecked(), Nan::New(cpuData.flags[CPU_FEATURE_FSRS]));
+	features->Set(Nan::New("fastShortRepCmpsb").ToLocalChecked(), Nan::New(cpuData.flags[CPU_FEATURE_FSRCS]));
+	features->Set(Nan::New("amxFp16").ToLocalChecked(), Nan::New(cpuData.flags[CPU_FEATURE_AMX_FP16]));
+	features->Set(Nan::New("avxIfma").ToLocalChecked(), Nan::New(cpuData.flags[CPU_FEATURE_AVX_IFMA]));
+	features->Set(Nan::New("avxVnniInt8").ToLocalChecked(), Nan::New(cpuData.flags[CPU_FEATURE_AVX_VNNI_INT8]));
+	features->Set(Nan::New("avxNeConvert").ToLocalChecked(), Nan::New(cpuData.flags[CPU_FEATURE_AVX_NE_CONVERT]));
+	features->Set(Nan::New("avx10").ToLocalChecked(), Nan::New(cpuData.flags[CPU_FEATURE_AVX10]));
+	features->Set(Nan::New("psfd").ToLocalChecked(), Nan::New(cpuData.flags[CPU_FEATURE_PSFD]));
+	features->Set(Nan::New("ipredCtrl").ToLocalChecked(), Nan::New(cpuData.flags[CPU_FEATURE_IPRED_CTRL]));
+	features->Set(Nan::New("rrsbaCtrl").ToLocalChecked(), Nan::New(cpuData.flags[CPU_FEATURE_RRSBA_CTRL]));
+	features->Set(Nan::New("bhiCtrl").ToLocalChecked(), Nan::New(cpuData.flags[CPU_FEATURE_BHI_CTRL]));
 }
 
 static void fillCache(Handle<Object> cache, cpu_id_t& cpuData) {
@@ -151,6 +300,10 @@ static void fillCache(Handle<Object> cache, cpu_id_t& cpuData) {
 	l3->Set(Nan::New("size").ToLocalChecked(), Nan::New(cpuData.l3_cache));
 	l3->Set(Nan::New("associativity").ToLocalChecked(), Nan::New(cpuData.l3_assoc));
 	l3->Set(Nan::New("cacheline").ToLocalChecked(), Nan::New(cpuData.l3_cacheline));
+
+	freezeObject(l1);
+	freezeObject(l2);
+	freezeObject(l3);
 }
 
 static void fillId(Handle<Object> id, cpu_id_t& cpuData) {
@@ -161,23 +314,188 @@ static void fillId(Handle<Object> id, cpu_id_t& cpuData) {
 	id->Set(Nan::New("extModel").ToLocalChecked(), Nan::New(cpuData.ext_model));
 }
 
+// One bit per cpu_feature_t, in 32-bit words: bit (f & 31) of word (f >> 5)
+static const int featureWords = (NUM_CPU_FEATURES + 31) / 32;
 
+static Local<Uint32Array> buildFeatureBits(cpu_id_t& cpuData) {
+	Local<ArrayBuffer> buffer = ArrayBuffer::New(Isolate::GetCurrent(), featureWords * sizeof(uint32_t));
+	Local<Uint32Array> bits = Uint32Array::New(buffer, 0, featureWords);
+	Nan::TypedArrayContents<uint32_t> contents(bits);
+	uint32_t* words = *contents;
 
-NAN_METHOD(GetCPUID) {
-	if(!cpuid_present()) {
-		return Nan::ThrowError("CPUID instruction not available");
+	for(int f = 0; f < NUM_CPU_FEATURES; f++) {
+		if(cpuData.flags[f]) {
+			words[f >> 5] |= 1u << (f & 31);
+		}
 	}
 
+	return bits;
+}
+
+// Maps the upper-cased libcpuid feature names ("AVX2", "SSE4_2"...) to
+// their bit numbers in buildFeatureBits()
+static Local<Object> buildFeatureConstants() {
+	Local<Object> constants = Nan::New<Object>();
+	for(int f = 0; f < NUM_CPU_FEATURES; f++) {
+		std::string name(cpu_feature_str(static_cast<cpu_feature_t>(f)));
+		for(size_t i = 0; i < name.size(); i++) {
+			name[i] = static_cast<char>(toupper(name[i]));
+		}
+		constants->Set(Nan::New(name).ToLocalChecked(), Nan::New(f));
+	}
+
+	return freezeObject(constants);
+}
+
+static void fillUsableIsa(Handle<Object> isa, cpu_raw_data_t& raw) {
+	cpu_usable_isa_t usable;
+	cpuid_get_usable_isa(&raw, &usable);
+	isa->Set(Nan::New("tier").ToLocalChecked(), Nan::New(cpu_isa_tier_str(usable.tier)).ToLocalChecked());
+	isa->Set(Nan::New("sse2").ToLocalChecked(), Nan::New<Boolean>(usable.sse2 != 0));
+	isa->Set(Nan::New("sse42").ToLocalChecked(), Nan::New<Boolean>(usable.sse4_2 != 0));
+	isa->Set(Nan::New("avx").ToLocalChecked(), Nan::New<Boolean>(usable.avx != 0));
+	isa->Set(Nan::New("avx2").ToLocalChecked(), Nan::New<Boolean>(usable.avx2 != 0));
+	isa->Set(Nan::New("avx512").ToLocalChecked(), Nan::New<Boolean>(usable.avx512 != 0));
+	isa->Set(Nan::New("amx").ToLocalChecked(), Nan::New<Boolean>(usable.amx != 0));
+	isa->Set(Nan::New("xcr0").ToLocalChecked(), Nan::New<Number>(static_cast<double>(usable.xcr0)));
+	isa->Set(Nan::New("xsaveSize").ToLocalChecked(), Nan::New(usable.xsave_size));
+	isa->Set(Nan::New("xsaveMaxSize").ToLocalChecked(), Nan::New(usable.xsave_max_size));
+}
+
+
+
+/*
+ * The features, cache, id and usableIsa sub-objects are only built when they
+ * are first read. Each result object keeps its own copy of the data they are
+ * built from, which is released when the object is garbage collected.
+ */
+enum LazyField {
+	LAZY_FEATURES,
+	LAZY_CACHE,
+	LAZY_ID,
+	LAZY_USABLE_ISA,
+	LAZY_FIELD_COUNT
+};
+
+struct LazyCPUID {
 	cpu_raw_data_t raw;
-	if(cpuid_get_raw_data(&raw) < 0) {
-		return Nan::ThrowError("Could not execute CPUID");
+	cpu_id_t id;
+	Nan::Persistent<Object> fields[LAZY_FIELD_COUNT];
+	Nan::Persistent<Object> owner;
+};
+
+static void releaseLazyCPUID(const Nan::WeakCallbackInfo<LazyCPUID>& info) {
+	LazyCPUID* lazy = info.GetParameter();
+	for(int i = 0; i < LAZY_FIELD_COUNT; i++) {
+		lazy->fields[i].Reset();
+	}
+	lazy->owner.Reset();
+	delete lazy;
+}
+
+static Local<Value> materialize(const Nan::PropertyCallbackInfo<Value>& info, LazyField field) {
+	LazyCPUID* lazy = static_cast<LazyCPUID*>(info.Data().As<External>()->Value());
+	if(lazy->fields[field].IsEmpty()) {
+		Local<Object> obj = Nan::New<Object>();
+		switch(field) {
+			case LAZY_FEATURES:
+				fillFeatures(obj, lazy->id);
+				break;
+
+			case LAZY_CACHE:
+				fillCache(obj, lazy->id);
+				break;
+
+			case LAZY_ID:
+				fillId(obj, lazy->id);
+				break;
+
+			default:
+				fillUsableIsa(obj, lazy->raw);
+				break;
+		}
+		lazy->fields[field].Reset(freezeObject(obj));
+	}
+
+	return Nan::New(lazy->fields[field]);
+}
+
+NAN_GETTER(GetFeatures) {
+	info.GetReturnValue().Set(materialize(info, LAZY_FEATURES));
+}
+
+NAN_GETTER(GetCache) {
+	info.GetReturnValue().Set(materialize(info, LAZY_CACHE));
+}
+
+NAN_GETTER(GetId) {
+	info.GetReturnValue().Set(materialize(info, LAZY_ID));
+}
+
+NAN_GETTER(GetUsableIsa) {
+	info.GetReturnValue().Set(materialize(info, LAZY_USABLE_ISA));
+}
+
+static void setLazyFields(Local<Object> data, cpu_raw_data_t& raw, cpu_id_t& cpuData) {
+	LazyCPUID* lazy = new LazyCPUID();
+	lazy->raw = raw;
+	lazy->id = cpuData;
+	lazy->owner.Reset(data);
+	lazy->owner.SetWeak(lazy, releaseLazyCPUID, Nan::WeakCallbackType::kParameter);
+
+	Local<Value> external = Nan::New<External>(lazy);
+	Nan::SetAccessor(data, Nan::New("features").ToLocalChecked(), GetFeatures, 0, external, DEFAULT, ReadOnly);
+	Nan::SetAccessor(data, Nan::New("cache").ToLocalChecked(), GetCache, 0, external, DEFAULT, ReadOnly);
+	Nan::SetAccessor(data, Nan::New("id").ToLocalChecked(), GetId, 0, external, DEFAULT, ReadOnly);
+	Nan::SetAccessor(data, Nan::New("usableIsa").ToLocalChecked(), GetUsableIsa, 0, external, DEFAULT, ReadOnly);
+}
+
+static const char* probeCPUID(CPUIDSnapshot& snap) {
+	if(!cpuid_present()) {
+		return "CPUID instruction not available";
+	}
+
+	if(cpuid_get_raw_data(&snap.raw) < 0) {
+		return "Could not execute CPUID";
+	}
+
+	if(cpu_identify(&snap.raw, &snap.id) < 0) {
+		return "Could not parse CPUID data";
+	}
+
+	snap.clock = cpu_clock_resolve(&snap.raw, &snap.clockInfo);
+	return NULL;
+}
+
+static void installSnapshot(CPUIDSnapshot& fresh) {
+	fresh.probed = true;
+	snapshot = fresh;
+	snapshotGeneration++;
+}
+
+// Probes without holding SharedLock, since resolving the clock can busy-wait
+// for up to 200 ms, and installs the result unless another caller got there
+// first. Must be called without SharedLock
+static void ensureSnapshot() {
+	{
+		SharedLock lock;
+		if(snapshot.probed) {
+			return;
+		}
 	}
 
-	cpu_id_t cpuData;
-	if(cpu_identify(&raw, &cpuData) < 0) {
-		return Nan::ThrowError("Could not parse CPUID data");
+	CPUIDSnapshot fresh;
+	fresh.error = probeCPUID(fresh);
+
+	SharedLock lock;
+	if(!snapshot.probed) {
+		installSnapshot(fresh);
 	}
+}
 
+static Local<Object> buildCPUID(CPUIDSnapshot& snap) {
+	cpu_id_t& cpuData = snap.id;
+	int clock = snap.clock;
 	Local<Object> data = Nan::New<Object>();
 	data->Set(Nan::New("vendorName").ToLocalChecked(), Nan::New(cpuData.vendor_str).ToLocalChecked());
 	data->Set(Nan::New("vendor").ToLocalChecked(), Nan::New(mapVendor(cpuData.vendor)).ToLocalChecked());
@@ -187,26 +505,388 @@ NAN_METHOD(GetCPUID) {
 	data->Set(Nan::New("physicalCores").ToLocalChecked(), Nan::New(cpuData.num_cores));
 	data->Set(Nan::New("logicalCores").ToLocalChecked(), Nan::New(cpuData.num_logical_cpus));
 	data->Set(Nan::New("totalCores").ToLocalChecked(), Nan::New(cpuData.total_logical_cpus));
-	data->Set(Nan::New("clockSpeed").ToLocalChecked(), Nan::New(cpu_clock()));
+	data->Set(Nan::New("clockSpeed").ToLocalChecked(), Nan::New(clock));
+	data->Set(Nan::New("maxClockSpeed").ToLocalChecked(), Nan::New(snap.clockInfo.max_mhz));
+	data->Set(Nan::New("clockSource").ToLocalChecked(), Nan::New(cpu_clock_source_str(snap.clockInfo.source)).ToLocalChecked());
+
+	setLazyFields(data, snap.raw, cpuData);
+	return freezeObject(data);
+}
+
+// Sweeps the CPUs without holding SharedLock, since that pins a thread to
+// each of them in turn, and installs the result unless another caller got
+// there first. Must be called without SharedLock
+static void ensureLogicalCPUs() {
+	{
+		SharedLock lock;
+		if(logicalCPUs.probed) {
+			return;
+		}
+	}
+
+	LogicalCPUsSnapshot fresh;
+	fresh.probed = true;
+	if(!cpuid_present()) {
+		fresh.error = "CPUID instruction not available";
+	}
+	else if(cpuid_get_all_raw_data(&fresh.raw) < 0) {
+		fresh.error = "Could not execute CPUID on every CPU";
+	}
+
+	SharedLock lock;
+	if(!logicalCPUs.probed) {
+		logicalCPUs = fresh;
+	}
+	else {
+		cpuid_free_raw_data_array(&fresh.raw);
+	}
+}
+
+// The error of the installed sweep, or one if refresh() dropped it between
+// ensureLogicalCPUs() and now. Must be called under SharedLock
+static const char* logicalCPUsError() {
+	if(!logicalCPUs.probed) {
+		return "The CPUs were refreshed while being probed";
+	}
+	return logicalCPUs.error;
+}
+
+static void resetLogicalCPUs() {
+	cpuid_free_raw_data_array(&logicalCPUs.raw);
+	logicalCPUs.probed = false;
+	logicalCPUs.error = NULL;
+	logicalCPUsGeneration++;
+}
+
+// Drops this instance's per-CPU objects if they were built before the
+// last refresh()
+static void syncLogicalCPUs(AddonData* addon) {
+	if(addon->logicalCPUsGeneration != logicalCPUsGeneration) {
+		addon->logicalCPUsObject.Reset();
+		addon->topologyObject.Reset();
+		addon->cacheTopologyObject.Reset();
+		addon->logicalCPUsGeneration = logicalCPUsGeneration;
+	}
+}
+
+static Local<Object> buildLogicalCPU(cpu_logical_raw_t& cpu, cpu_id_t& cpuData) {
+	Local<Object> data = Nan::New<Object>();
+	data->Set(Nan::New("cpu").ToLocalChecked(), Nan::New(cpu.os_cpu));
+	data->Set(Nan::New("apicId").ToLocalChecked(), Nan::New(cpu.apic_id));
+	data->Set(Nan::New("vendorName").ToLocalChecked(), Nan::New(cpuData.vendor_str).ToLocalChecked());
+	data->Set(Nan::New("vendor").ToLocalChecked(), Nan::New(mapVendor(cpuData.vendor)).ToLocalChecked());
+	data->Set(Nan::New("brand").ToLocalChecked(), Nan::New(cpuData.brand_str).ToLocalChecked());
+	data->Set(Nan::New("codeName").ToLocalChecked(), Nan::New(cpuData.cpu_codename).ToLocalChecked());
+
+	setLazyFields(data, cpu.raw, cpuData);
+	return freezeObject(data);
+}
+
+static Local<Object> buildTopology(cpu_topology_t& topo) {
+	// Entries are sorted by package, core and thread, so each array is
+	// complete (and can be frozen) as soon as the next one is started
+	Local<Array> packages = Nan::New<Array>();
+	Local<Array> cores;
+	Local<Array> threads;
+	for(int i = 0; i < topo.num_entries; i++) {
+		cpu_topology_entry_t& entry = topo.entries[i];
+		bool newPackage = i == 0 || entry.package_id != topo.entries[i - 1].package_id;
+		bool newCore = newPackage || entry.core_id != topo.entries[i - 1].core_id;
+
+		if(newCore && i > 0) {
+			freezeObject(threads);
+		}
+
+		if(newPackage) {
+			if(i > 0) {
+				freezeObject(cores);
+			}
+
+			Local<Object> package = Nan::New<Object>();
+			cores = Nan::New<Array>();
+			package->Set(Nan::New("id").ToLocalChecked(), Nan::New(entry.package_id));
+			package->Set(Nan::New("cores").ToLocalChecked(), cores);
+			packages->Set(packages->Length(), freezeObject(package));
+		}
+
+		if(newCore) {
+			Local<Object> core = Nan::New<Object>();
+			threads = Nan::New<Array>();
+			core->Set(Nan::New("id").ToLocalChecked(), Nan::New(entry.core_id));
+			core->Set(Nan::New("threads").ToLocalChecked(), threads);
+			cores->Set(cores->Length(), freezeObject(core));
+		}
+
+		Local<Object> thread = Nan::New<Object>();
+		thread->Set(Nan::New("id").ToLocalChecked(), Nan::New(entry.smt_id));
+		thread->Set(Nan::New("cpu").ToLocalChecked(), Nan::New(entry.os_cpu));
+		thread->Set(Nan::New("apicId").ToLocalChecked(), Nan::New(entry.apic_id));
+		threads->Set(threads->Length(), freezeObject(thread));
+	}
+
+	if(topo.num_entries > 0) {
+		freezeObject(threads);
+		freezeObject(cores);
+	}
+
+	Local<Object> data = Nan::New<Object>();
+	data->Set(Nan::New("packageCount").ToLocalChecked(), Nan::New(topo.num_packages));
+	data->Set(Nan::New("coreCount").ToLocalChecked(), Nan::New(topo.num_cores));
+	data->Set(Nan::New("threadCount").ToLocalChecked(), Nan::New(topo.num_entries));
+	data->Set(Nan::New("smtShift").ToLocalChecked(), Nan::New(topo.smt_shift));
+	data->Set(Nan::New("packageShift").ToLocalChecked(), Nan::New(topo.pkg_shift));
+	data->Set(Nan::New("packages").ToLocalChecked(), freezeObject(packages));
+	return freezeObject(data);
+}
+
+static const char* mapCacheType(int32_t type) {
+	switch(type) {
+		case 1:
+			return "data";
+
+		case 2:
+			return "instruction";
+
+		case 3:
+			return "unified";
+
+		default:
+			return "unknown";
+	}
+}
+
+static Local<Array> buildCacheTopology(cpu_cache_topology_t& caches) {
+	Local<Array> data = Nan::New<Array>(caches.num_caches);
+	for(int i = 0; i < caches.num_caches; i++) {
+		cpu_cache_instance_t& instance = caches.caches[i];
+		Local<Array> cpus = Nan::New<Array>(instance.num_cpus);
+		for(int j = 0; j < instance.num_cpus; j++) {
+			cpus->Set(j, Nan::New(instance.os_cpus[j]));
+		}
+
+		Local<Object> cache = Nan::New<Object>();
+		cache->Set(Nan::New("level").ToLocalChecked(), Nan::New(instance.level));
+		cache->Set(Nan::New("type").ToLocalChecked(), Nan::New(mapCacheType(instance.type)).ToLocalChecked());
+		cache->Set(Nan::New("size").ToLocalChecked(), Nan::New(instance.size));
+		cache->Set(Nan::New("cacheline").ToLocalChecked(), Nan::New(instance.linesize));
+		cache->Set(Nan::New("id").ToLocalChecked(), Nan::New(instance.cache_id));
+		cache->Set(Nan::New("cpus").ToLocalChecked(), freezeObject(cpus));
+		data->Set(i, freezeObject(cache));
+	}
+
+	return freezeObject(data).As<Array>();
+}
+
+// Returns this instance's object for the shared snapshot, building it if
+// the snapshot changed since. Must be called under SharedLock
+static Local<Object> snapshotObject(AddonData* addon) {
+	if(addon->snapshotObject.IsEmpty() || addon->snapshotGeneration != snapshotGeneration) {
+		addon->snapshotObject.Reset(buildCPUID(snapshot));
+		addon->snapshotGeneration = snapshotGeneration;
+	}
+
+	return Nan::New(addon->snapshotObject);
+}
+
+NAN_METHOD(GetCPUID) {
+	ensureSnapshot();
+	SharedLock lock;
+	if(snapshot.error) {
+		return Nan::ThrowError(snapshot.error);
+	}
 
-	Local<Object> features = Nan::New<Object>();
-	data->Set(Nan::New("features").ToLocalChecked(), features);
-	fillFeatures(features, cpuData);
+	info.GetReturnValue().Set(snapshotObject(getAddonData(info)));
+}
+
+NAN_METHOD(Refresh) {
+	CPUIDSnapshot fresh;
+	const char* error = probeCPUID(fresh);
+	if(error) {
+		return Nan::ThrowError(error);
+	}
+
+	SharedLock lock;
+	installSnapshot(fresh);
+	resetLogicalCPUs();
+	info.GetReturnValue().Set(snapshotObject(getAddonData(info)));
+}
+
+NAN_METHOD(GetFeatureBits) {
+	ensureSnapshot();
+	SharedLock lock;
+	if(snapshot.error) {
+		return Nan::ThrowError(snapshot.error);
+	}
+
+	// Typed arrays cannot be frozen, so every caller gets its own copy
+	info.GetReturnValue().Set(buildFeatureBits(snapshot.id));
+}
+
+NAN_METHOD(GetLogicalCPUs) {
+	AddonData* addon = getAddonData(info);
+	ensureLogicalCPUs();
+	SharedLock lock;
+	if(logicalCPUsError()) {
+		return Nan::ThrowError(logicalCPUsError());
+	}
+
+	syncLogicalCPUs(addon);
+	if(addon->logicalCPUsObject.IsEmpty()) {
+		Local<Array> cpus = Nan::New<Array>(logicalCPUs.raw.num_raw);
+		for(int i = 0; i < logicalCPUs.raw.num_raw; i++) {
+			cpu_id_t cpuData;
+			if(cpu_identify(&logicalCPUs.raw.cpus[i].raw, &cpuData) < 0) {
+				return Nan::ThrowError("Could not parse CPUID data");
+			}
+			cpus->Set(i, buildLogicalCPU(logicalCPUs.raw.cpus[i], cpuData));
+		}
+		addon->logicalCPUsObject.Reset(freezeObject(cpus).As<Array>());
+	}
+
+	info.GetReturnValue().Set(Nan::New(addon->logicalCPUsObject));
+}
+
+/*
+ * Runs the probe, including the clock measurement, on the libuv thread pool
+ * and installs the result as the shared snapshot once it is back on the
+ * calling thread, unless another caller got there first.
+ */
+class ProbeWorker : public Nan::AsyncWorker {
+public:
+	ProbeWorker(Nan::Callback* callback, AddonData* addon)
+		: Nan::AsyncWorker(callback), addon(addon) {
+		SharedLock lock;
+		needProbe = !snapshot.probed;
+	}
+
+	void Execute() {
+		if(needProbe) {
+			fresh.error = probeCPUID(fresh);
+		}
+	}
 
-	Local<Object> cache = Nan::New<Object>();
-	data->Set(Nan::New("cache").ToLocalChecked(), cache);
-	fillCache(cache, cpuData);
+	void HandleOKCallback() {
+		Nan::HandleScope scope;
+		const char* error;
+		Local<Object> result;
+
+		// The lock must be released before calling back into JavaScript
+		{
+			SharedLock lock;
+			if(!snapshot.probed) {
+				installSnapshot(fresh);
+			}
+
+			error = snapshot.error;
+			if(!error) {
+				result = snapshotObject(addon);
+			}
+		}
+
+		if(error) {
+			Local<Value> argv[] = { Nan::Error(error) };
+			callback->Call(1, argv, async_resource);
+			return;
+		}
+
+		Local<Value> argv[] = { Nan::Null(), result };
+		callback->Call(2, argv, async_resource);
+	}
+
+private:
+	AddonData* addon;
+	bool needProbe;
+	CPUIDSnapshot fresh;
+};
+
+NAN_METHOD(GetCPUIDAsync) {
+	if(!info[0]->IsFunction()) {
+		return Nan::ThrowTypeError("Callback must be a function");
+	}
+
+	Nan::Callback* callback = new Nan::Callback(info[0].As<Function>());
+	Nan::AsyncQueueWorker(new ProbeWorker(callback, getAddonData(info)));
+}
+
+NAN_METHOD(GetTopology) {
+	AddonData* addon = getAddonData(info);
+	ensureLogicalCPUs();
+	SharedLock lock;
+	if(logicalCPUsError()) {
+		return Nan::ThrowError(logicalCPUsError());
+	}
+
+	syncLogicalCPUs(addon);
+	if(addon->topologyObject.IsEmpty()) {
+		cpu_topology_t topo;
+		if(cpuid_get_topology(&logicalCPUs.raw, &topo) < 0) {
+			return Nan::ThrowError(cpuid_error());
+		}
+		addon->topologyObject.Reset(buildTopology(topo));
+		cpuid_free_topology(&topo);
+	}
 
-	Local<Object> id = Nan::New<Object>();
-	data->Set(Nan::New("id").ToLocalChecked(), id);
-	fillId(id, cpuData);
+	info.GetReturnValue().Set(Nan::New(addon->topologyObject));
+}
+
+NAN_METHOD(GetCacheTopology) {
+	AddonData* addon = getAddonData(info);
+	ensureLogicalCPUs();
+	SharedLock lock;
+	if(logicalCPUsError()) {
+		return Nan::ThrowError(logicalCPUsError());
+	}
+
+	syncLogicalCPUs(addon);
+	if(addon->cacheTopologyObject.IsEmpty()) {
+		cpu_cache_topology_t caches;
+		if(cpuid_get_cache_topology(&logicalCPUs.raw, &caches) < 0) {
+			return Nan::ThrowError(cpuid_error());
+		}
+		addon->cacheTopologyObject.Reset(buildCacheTopology(caches));
+		cpuid_free_cache_topology(&caches);
+	}
+
+	info.GetReturnValue().Set(Nan::New(addon->cacheTopologyObject));
+}
+
+#if NODE_MODULE_VERSION >= NODE_10_0_MODULE_VERSION
+static void freeAddonData(void* arg) {
+	delete static_cast<AddonData*>(arg);
+}
+#endif
 
-	info.GetReturnValue().Set(data);
+static void setMethod(Local<Object> target, const char* name, Nan::FunctionCallback method, Local<Value> data) {
+	Nan::Set(target, Nan::New(name).ToLocalChecked(),
+		Nan::GetFunction(Nan::New<FunctionTemplate>(method, data)).ToLocalChecked());
 }
 
 NAN_MODULE_INIT(InitAll) {
-	Nan::Set(target, Nan::New("getCPUID").ToLocalChecked(),
-		Nan::GetFunction(Nan::New<FunctionTemplate>(GetCPUID)).ToLocalChecked());
+	AddonData* addon = new AddonData();
+#if NODE_MODULE_VERSION >= NODE_10_0_MODULE_VERSION
+	node::AddEnvironmentCleanupHook(Isolate::GetCurrent(), freeAddonData, addon);
+#endif
+	Local<Value> data = Nan::New<External>(addon);
+
+	setMethod(target, "getCPUID", GetCPUID, data);
+	setMethod(target, "refresh", Refresh, data);
+	setMethod(target, "getCPUIDAsync", GetCPUIDAsync, data);
+	setMethod(target, "getFeatureBits", GetFeatureBits, data);
+	Nan::Set(target, Nan::New("FEATURE").ToLocalChecked(), buildFeatureConstants());
+	setMethod(target, "getLogicalCPUs", GetLogicalCPUs, data);
+	setMethod(target, "getTopology", GetTopology, data);
+	setMethod(target, "getCacheTopology", GetCacheTopology, data);
+
+	InitTimer(target);
+	InitMSR(target);
+	InitThermal(target);
+	InitPower(target);
+	InitTurbo(target);
+	InitHWP(target);
+	InitFrequency(target);
+	InitTelemetry(target);
+	InitCPUTimes(target);
+	InitCgroup(target);
 }
 
-NODE_MODULE(cpuid, InitAll)
+NAN_MODULE_WORKER_ENABLED(cpuid, InitAll)
@@ -0,0 +1,162 @@
+#include "addon.h"
+#include <libcpuid.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+using namespace v8;
+
+/*
+ * The columns of the buffer that read() fills, each one value per CPU: the
+ * times in milliseconds since boot, as os.cpus() reports them, then the
+ * current frequency in MHz.
+ */
+enum CPUTimesColumn {
+	CPU_TIMES_USER = 0,
+	CPU_TIMES_NICE,
+	CPU_TIMES_SYS,
+	CPU_TIMES_IDLE,
+	CPU_TIMES_IRQ,
+	CPU_TIMES_STEAL,
+	CPU_TIMES_IOWAIT,
+	CPU_TIMES_SOFTIRQ,
+	CPU_TIMES_SPEED,
+	CPU_TIMES_COLUMNS
+};
+
+/*
+ * Keeps /proc/stat and the cpufreq attributes open between reads, along with
+ * the previous reading for utilization. It lives as long as its read()
+ * function does.
+ */
+struct CPUTimesReader {
+	cpu_times_reader_t* times;
+	cpu_freq_sampler_t* freq;
+	int cpus;
+	double msPerTick;
+	std::vector<cpu_times_t> current;
+	std::vector<cpu_times_t> previous;
+	std::vector<double> mhz;
+	Nan::Persistent<Function> owner;
+};
+
+static void releaseCPUTimesReader(const Nan::WeakCallbackInfo<CPUTimesReader>& info) {
+	CPUTimesReader* reader = info.GetParameter();
+	reader->owner.Reset();
+	cpu_times_close(reader->times);
+	cpu_freq_sampler_destroy(reader->freq);
+	delete reader;
+}
+
+// Fills the columns, and the utilization since the previous read if given
+NAN_METHOD(ReadCPUTimes) {
+	CPUTimesReader* reader = static_cast<CPUTimesReader*>(info.Data().As<External>()->Value());
+	if(!info[0]->IsFloat64Array()) {
+		return Nan::ThrowTypeError("Times must be a Float64Array");
+	}
+
+	Nan::TypedArrayContents<double> columns(info[0]);
+	int cpus = reader->cpus;
+	if(columns.length() != static_cast<size_t>(cpus * CPU_TIMES_COLUMNS)) {
+		return Nan::ThrowRangeError("Times must have a column of every CPU for each field");
+	}
+	if(info[1]->IsFloat64Array() && Nan::TypedArrayContents<double>(info[1]).length() != static_cast<size_t>(cpus)) {
+		return Nan::ThrowRangeError("Utilization must have an entry for every CPU");
+	}
+
+	int count = cpu_times_read(reader->times, reader->current.data(), static_cast<int>(reader->current.size()));
+	if(count < 0) {
+		return Nan::ThrowError(cpuid_error());
+	}
+
+	double* out = *columns;
+	std::fill(out, out + cpus * CPU_TIMES_COLUMNS, -1.0);
+	for(int i = 0; i < count; i++) {
+		const cpu_times_t& t = reader->current[i];
+		if(t.cpu < 0 || t.cpu >= cpus) {
+			continue;
+		}
+		double ms = reader->msPerTick;
+		out[CPU_TIMES_USER * cpus + t.cpu] = t.user * ms;
+		out[CPU_TIMES_NICE * cpus + t.cpu] = t.nice * ms;
+		out[CPU_TIMES_SYS * cpus + t.cpu] = t.system * ms;
+		out[CPU_TIMES_IDLE * cpus + t.cpu] = t.idle * ms;
+		out[CPU_TIMES_IRQ * cpus + t.cpu] = t.irq * ms;
+		out[CPU_TIMES_STEAL * cpus + t.cpu] = t.steal * ms;
+		out[CPU_TIMES_IOWAIT * cpus + t.cpu] = t.iowait * ms;
+		out[CPU_TIMES_SOFTIRQ * cpus + t.cpu] = t.softirq * ms;
+	}
+
+	if(reader->freq) {
+		int n = cpu_freq_sample(reader->freq, reader->mhz.data(), static_cast<int>(reader->mhz.size()));
+		for(int i = 0; i < n; i++) {
+			int cpu = cpu_freq_sampler_cpu(reader->freq, i);
+			if(cpu < cpus) {
+				out[CPU_TIMES_SPEED * cpus + cpu] = reader->mhz[i];
+			}
+		}
+	}
+
+	if(info[1]->IsFloat64Array()) {
+		Nan::TypedArrayContents<double> utilization(info[1]);
+		for(int cpu = 0; cpu < cpus; cpu++) {
+			(*utilization)[cpu] = -1;
+		}
+		for(int i = 0; i < count; i++) {
+			int cpu = reader->current[i].cpu;
+			if(cpu >= 0 && cpu < cpus) {
+				(*utilization)[cpu] = cpu_times_utilization(&reader->previous[cpu], &reader->current[i]);
+			}
+		}
+	}
+
+	for(int i = 0; i < count; i++) {
+		int cpu = reader->current[i].cpu;
+		if(cpu >= 0 && cpu < cpus) {
+			reader->previous[cpu] = reader->current[i];
+		}
+	}
+}
+
+// Explicit procfs and sysfs roots read a test fixture instead
+NAN_METHOD(CreateCPUTimesReader) {
+	std::string procRoot, sysRoot;
+	if(info[0]->IsString()) {
+		procRoot = *Nan::Utf8String(info[0]);
+	}
+	if(info[1]->IsString()) {
+		sysRoot = *Nan::Utf8String(info[1]);
+	}
+
+	cpu_times_reader_t* times = cpu_times_open(procRoot.empty() ? NULL : procRoot.c_str());
+	if(!times) {
+		return Nan::ThrowError(cpuid_error());
+	}
+
+	CPUTimesReader* reader = new CPUTimesReader();
+	reader->times = times;
+	reader->freq = cpu_freq_sampler_create(sysRoot.empty() ? NULL : sysRoot.c_str());
+	reader->cpus = countCPUs(reader->freq, times);
+	reader->msPerTick = 1000.0 / cpu_times_ticks_per_second();
+	reader->current.resize(reader->cpus);
+	reader->previous.resize(reader->cpus);
+	for(int cpu = 0; cpu < reader->cpus; cpu++) {
+		reader->previous[cpu].cpu = -1;
+	}
+	reader->mhz.resize(cpu_freq_sampler_count(reader->freq));
+
+	Local<Function> read = Nan::GetFunction(Nan::New<FunctionTemplate>(ReadCPUTimes, Nan::New<External>(reader))).ToLocalChecked();
+	reader->owner.Reset(read);
+	reader->owner.SetWeak(reader, releaseCPUTimesReader, Nan::WeakCallbackType::kParameter);
+
+	Local<Object> data = Nan::New<Object>();
+	data->Set(Nan::New("cpus").ToLocalChecked(), Nan::New(reader->cpus));
+	data->Set(Nan::New("columns").ToLocalChecked(), Nan::New(static_cast<int>(CPU_TIMES_COLUMNS)));
+	data->Set(Nan::New("read").ToLocalChecked(), read);
+	info.GetReturnValue().Set(data);
+}
+
+NAN_MODULE_INIT(InitCPUTimes) {
+	Nan::Set(target, Nan::New("createCPUTimesReader").ToLocalChecked(),
+		Nan::GetFunction(Nan::New<FunctionTemplate>(CreateCPUTimesReader)).ToLocalChecked());
+}
@@ -0,0 +1,201 @@
+#include "addon.h"
+#include <libcpuid.h>
+#include <stdlib.h>
+#include <string>
+
+using namespace v8;
+
+/*
+ * A frequency sampler rereads the scaling_cur_freq attribute of every CPU on
+ * its own thread and writes the values straight into the memory behind a
+ * Float64Array, so JS reads the latest sample with a plain array access.
+ * Each value is a single aligned 64-bit store, so no value is ever torn; a
+ * read can however mix values of two consecutive samples.
+ *
+ * The memory belongs to the sampler, not to V8. The sampler lives until both
+ * the array buffer and the stop() function are collected: the thread stops
+ * with the first of stop() and the collection of the buffer, and the memory
+ * is freed with the second. The exit of its environment (e.g. a worker)
+ * stops it and frees it at once, as the weak callbacks never run then.
+ */
+struct FrequencySampler {
+	cpu_freq_sampler_t* sampler;
+	double* mhz;
+	int count;
+	uint64_t intervalNs;
+
+	uv_thread_t thread;
+	uv_mutex_t lock;
+	uv_cond_t wake;
+	bool running;
+	bool stopping;
+
+	int refs;
+	Nan::Persistent<ArrayBuffer> buffer;
+	Nan::Persistent<Function> stop;
+
+	Isolate* isolate;
+	bool cleanupHook;
+};
+
+static void sampleFrequencies(void* arg) {
+	FrequencySampler* freq = static_cast<FrequencySampler*>(arg);
+
+	uv_mutex_lock(&freq->lock);
+	while(!freq->stopping) {
+		uv_mutex_unlock(&freq->lock);
+		cpu_freq_sample(freq->sampler, freq->mhz, freq->count);
+		uv_mutex_lock(&freq->lock);
+		if(!freq->stopping) {
+			uv_cond_timedwait(&freq->wake, &freq->lock, freq->intervalNs);
+		}
+	}
+	uv_mutex_unlock(&freq->lock);
+}
+
+static void stopFrequencySampler(FrequencySampler* freq) {
+	if(!freq->running) {
+		return;
+	}
+
+	uv_mutex_lock(&freq->lock);
+	freq->stopping = true;
+	uv_cond_signal(&freq->wake);
+	uv_mutex_unlock(&freq->lock);
+	uv_thread_join(&freq->thread);
+	freq->running = false;
+}
+
+#if NODE_MODULE_VERSION >= NODE_10_0_MODULE_VERSION
+static void cleanupFrequencySampler(void* arg);
+#endif
+
+static void releaseFrequencySampler(FrequencySampler* freq) {
+	if(--freq->refs > 0) {
+		return;
+	}
+
+#if NODE_MODULE_VERSION >= NODE_10_0_MODULE_VERSION
+	if(freq->cleanupHook) {
+		node::RemoveEnvironmentCleanupHook(freq->isolate, cleanupFrequencySampler, freq);
+	}
+#endif
+	stopFrequencySampler(freq);
+	cpu_freq_sampler_destroy(freq->sampler);
+	uv_cond_destroy(&freq->wake);
+	uv_mutex_destroy(&freq->lock);
+	free(freq->mhz);
+	delete freq;
+}
+
+static void releaseFrequencyBuffer(const Nan::WeakCallbackInfo<FrequencySampler>& info) {
+	FrequencySampler* freq = info.GetParameter();
+	freq->buffer.Reset();
+	stopFrequencySampler(freq);
+	releaseFrequencySampler(freq);
+}
+
+static void releaseFrequencyStop(const Nan::WeakCallbackInfo<FrequencySampler>& info) {
+	FrequencySampler* freq = info.GetParameter();
+	freq->stop.Reset();
+	releaseFrequencySampler(freq);
+}
+
+#if NODE_MODULE_VERSION >= NODE_10_0_MODULE_VERSION
+static void cleanupFrequencySampler(void* arg) {
+	FrequencySampler* freq = static_cast<FrequencySampler*>(arg);
+	freq->cleanupHook = false;
+	stopFrequencySampler(freq);
+	if(!freq->buffer.IsEmpty()) {
+		freq->buffer.Reset();
+		releaseFrequencySampler(freq);
+	}
+	if(!freq->stop.IsEmpty()) {
+		freq->stop.Reset();
+		releaseFrequencySampler(freq);
+	}
+}
+#endif
+
+NAN_METHOD(StopFrequencySampler) {
+	FrequencySampler* freq = static_cast<FrequencySampler*>(info.Data().As<External>()->Value());
+	stopFrequencySampler(freq);
+}
+
+// An explicit sysfs root reads a test fixture instead
+NAN_METHOD(CreateFrequencySampler) {
+	if(!info[0]->IsUint32()) {
+		return Nan::ThrowTypeError("Interval must be an unsigned integer");
+	}
+
+	uint32_t interval = Nan::To<uint32_t>(info[0]).FromJust();
+	std::string root;
+	if(info[1]->IsString()) {
+		root = *Nan::Utf8String(info[1]);
+	}
+
+	cpu_freq_sampler_t* sampler = cpu_freq_sampler_create(root.empty() ? NULL : root.c_str());
+	if(!sampler) {
+		return Nan::ThrowError(cpuid_error());
+	}
+
+	int count = cpu_freq_sampler_count(sampler);
+	double* mhz = static_cast<double*>(calloc(count, sizeof(double)));
+	if(!mhz) {
+		cpu_freq_sampler_destroy(sampler);
+		return Nan::ThrowError("Out of memory");
+	}
+
+	// The first sample is taken here, so that the array is never empty
+	cpu_freq_sample(sampler, mhz, count);
+
+	FrequencySampler* freq = new FrequencySampler();
+	freq->sampler = sampler;
+	freq->mhz = mhz;
+	freq->count = count;
+	freq->intervalNs = static_cast<uint64_t>(interval > 0 ? interval : 1) * 1000000;
+	freq->running = false;
+	freq->stopping = false;
+	freq->refs = 2;
+	freq->isolate = Isolate::GetCurrent();
+	freq->cleanupHook = false;
+	uv_mutex_init(&freq->lock);
+	uv_cond_init(&freq->wake);
+	if(uv_thread_create(&freq->thread, sampleFrequencies, freq) != 0) {
+		freq->refs = 1;
+		releaseFrequencySampler(freq);
+		return Nan::ThrowError("Cannot start the sampler thread");
+	}
+	freq->running = true;
+#if NODE_MODULE_VERSION >= NODE_10_0_MODULE_VERSION
+	node::AddEnvironmentCleanupHook(freq->isolate, cleanupFrequencySampler, freq);
+	freq->cleanupHook = true;
+#endif
+
+	Local<ArrayBuffer> buffer = ArrayBuffer::New(freq->isolate, mhz, count * sizeof(double),
+		ArrayBufferCreationMode::kExternalized);
+	freq->buffer.Reset(buffer);
+	freq->buffer.SetWeak(freq, releaseFrequencyBuffer, Nan::WeakCallbackType::kParameter);
+
+	Local<Function> stop = Nan::GetFunction(Nan::New<FunctionTemplate>(StopFrequencySampler, Nan::New<External>(freq))).ToLocalChecked();
+	freq->stop.Reset(stop);
+	freq->stop.SetWeak(freq, releaseFrequencyStop, Nan::WeakCallbackType::kParameter);
+
+	Local<ArrayBuffer> cpuBuffer = ArrayBuffer::New(Isolate::GetCurrent(), count * sizeof(int32_t));
+	Local<Int32Array> cpus = Int32Array::New(cpuBuffer, 0, count);
+	Nan::TypedArrayContents<int32_t> contents(cpus);
+	for(int i = 0; i < count; i++) {
+		(*contents)[i] = cpu_freq_sampler_cpu(sampler, i);
+	}
+
+	Local<Object> data = Nan::New<Object>();
+	data->Set(Nan::New("cpus").ToLocalChecked(), cpus);
+	data->Set(Nan::New("mhz").ToLocalChecked(), Float64Array::New(buffer, 0, count));
+	data->Set(Nan::New("stop").ToLocalChecked(), stop);
+	info.GetReturnValue().Set(data);
+}
+
+NAN_MODULE_INIT(InitFrequency) {
+	Nan::Set(target, Nan::New("createFrequencySampler").ToLocalChecked(),
+		Nan::GetFunction(Nan::New<FunctionTemplate>(CreateFrequencySampler)).ToLocalChecked());
+}
@@ -0,0 +1,98 @@
+#include "addon.h"
+#include <libcpuid.h>
+#include <string>
+#include <vector>
+
+using namespace v8;
+
+static Local<Value> levelValue(int value) {
+	if(value < 0) {
+		return Nan::Null();
+	}
+	return Nan::New(value);
+}
+
+/*
+ * Reads the performance levels of every CPU on the libuv thread pool, from
+ * IA32_HWP_CAPABILITIES where the shared MSR handles could be opened and from
+ * ACPI CPPC otherwise, and ranks them from the fastest to the slowest.
+ */
+class PerfLevelsWorker : public Nan::AsyncWorker {
+public:
+	PerfLevelsWorker(Nan::Callback* callback, const std::string& root)
+		: Nan::AsyncWorker(callback), root(root) {}
+
+	void Execute() {
+		msr_cpu_set_t* set = NULL;
+		int count = 0;
+
+		if(root.empty()) {
+			const char* msrError;
+			set = sharedMSRSet(&msrError);
+
+			uv_cpu_info_t* cpus;
+			if(uv_cpu_info(&cpus, &count) == 0) {
+				uv_free_cpu_info(cpus, count);
+			}
+			if(cpu_msr_set_size(set) > count) {
+				count = cpu_msr_set_size(set);
+			}
+		}
+		else {
+			count = FIXTURE_MAX_CPUS;
+		}
+
+		levels.resize(count > 0 ? count : 1);
+		int filled = cpu_perf_levels_read_all(set, root.empty() ? NULL : root.c_str(), levels.data(), count);
+		if(filled <= 0) {
+			return SetErrorMessage(cpuid_error());
+		}
+		levels.resize(filled);
+		cpu_perf_levels_rank(levels.data(), filled);
+	}
+
+	void HandleOKCallback() {
+		Nan::HandleScope scope;
+		Local<Array> result = Nan::New<Array>(static_cast<int>(levels.size()));
+
+		for(size_t i = 0; i < levels.size(); i++) {
+			Local<Object> cpu = Nan::New<Object>();
+			cpu->Set(Nan::New("cpu").ToLocalChecked(), Nan::New(levels[i].cpu));
+			cpu->Set(Nan::New("rank").ToLocalChecked(), Nan::New(levels[i].rank));
+			cpu->Set(Nan::New("source").ToLocalChecked(), Nan::New(cpu_perf_levels_source_str(levels[i].source)).ToLocalChecked());
+			cpu->Set(Nan::New("highest").ToLocalChecked(), levelValue(levels[i].highest));
+			cpu->Set(Nan::New("guaranteed").ToLocalChecked(), levelValue(levels[i].guaranteed));
+			cpu->Set(Nan::New("mostEfficient").ToLocalChecked(), levelValue(levels[i].most_efficient));
+			cpu->Set(Nan::New("lowest").ToLocalChecked(), levelValue(levels[i].lowest));
+			cpu->Set(Nan::New("highestMHz").ToLocalChecked(), levelValue(levels[i].highest_mhz));
+			result->Set(static_cast<uint32_t>(i), cpu);
+		}
+
+		Local<Value> argv[] = { Nan::Null(), result };
+		callback->Call(2, argv, async_resource);
+	}
+
+private:
+	std::string root;
+	std::vector<cpu_perf_levels_t> levels;
+};
+
+// An explicit sysfs root (e.g. a test fixture) means ACPI CPPC only
+NAN_METHOD(GetPerfLevels) {
+	if(!info[1]->IsFunction()) {
+		return Nan::ThrowTypeError("Callback must be a function");
+	}
+
+	std::string root;
+	if(info[0]->IsString()) {
+		root = *Nan::Utf8String(info[0]);
+	}
+
+	Nan::Callback* callback = new Nan::Callback(info[1].As<Function>());
+	Nan::AsyncQueueWorker(new PerfLevelsWorker(callback, root));
+}
+
+NAN_MODULE_INIT(InitHWP) {
+	Nan::Set(target, Nan::New("getPerfLevels").ToLocalChecked(),
+		Nan::GetFunction(Nan::New<FunctionTemplate>(GetPerfLevels)).ToLocalChecked());
+}
@@ -0,0 +1,164 @@
+#include "addon.h"
+#include <libcpuid.h>
+#include <vector>
+
+using namespace v8;
+
+/*
+ * The MSR handles of all online CPUs are opened once per process, by the
+ * first call that needs them, and then shared by every thread. Reads through
+ * a handle are independent system calls, so only opening needs the lock.
+ */
+static uv_once_t msrLockOnce = UV_ONCE_INIT;
+static uv_mutex_t msrLock;
+static bool msrOpened = false;
+static const char* msrError = NULL;
+static msr_cpu_set_t* msrSet = NULL;
+
+static void initMSRLock() {
+	uv_mutex_init(&msrLock);
+}
+
+msr_cpu_set_t* sharedMSRSet(const char** error) {
+	uv_once(&msrLockOnce, initMSRLock);
+	uv_mutex_lock(&msrLock);
+	if(!msrOpened) {
+		msrSet = cpu_msr_open_all();
+		if(!msrSet) {
+			msrError = cpuid_error();
+		}
+		msrOpened = true;
+	}
+	uv_mutex_unlock(&msrLock);
+
+	*error = msrError;
+	return msrSet;
+}
+
+NAN_METHOD(GetMSRCPUs) {
+	const char* error;
+	msr_cpu_set_t* set = sharedMSRSet(&error);
+	if(!set) {
+		return Nan::ThrowError(error);
+	}
+
+	Local<Array> cpus = Nan::New<Array>();
+	int size = cpu_msr_set_size(set);
+	for(int cpu = 0, n = 0; cpu < size; cpu++) {
+		if(cpu_msr_set_handle(set, cpu)) {
+			cpus->Set(n++, Nan::New(cpu));
+		}
+	}
+	info.GetReturnValue().Set(cpus);
+}
+
+// Returns [low, high], since MSR values do not fit in a double
+NAN_METHOD(ReadMSR) {
+	if(!info[0]->IsUint32() || !info[1]->IsUint32()) {
+		return Nan::ThrowTypeError("CPU and MSR must be unsigned integers");
+	}
+
+	const char* error;
+	msr_cpu_set_t* set = sharedMSRSet(&error);
+	if(!set) {
+		return Nan::ThrowError(error);
+	}
+
+	msr_driver_t* handle = cpu_msr_set_handle(set, Nan::To<uint32_t>(info[0]).FromJust());
+	if(!handle) {
+		return Nan::ThrowRangeError("No MSR handle for that CPU");
+	}
+
+	uint64_t value;
+	if(cpu_rdmsr(handle, Nan::To<uint32_t>(info[1]).FromJust(), &value) < 0) {
+		return Nan::ThrowError(cpuid_error());
+	}
+
+	Local<Array> result = Nan::New<Array>(2);
+	result->Set(0, Nan::New(static_cast<uint32_t>(value)));
+	result->Set(1, Nan::New(static_cast<uint32_t>(value >> 32)));
+	info.GetReturnValue().Set(result);
+}
+
+/*
+ * Reads a batch of (cpu, msr) pairs on the libuv thread pool, where
+ * cpu_rdmsr_batch() spreads them over its own threads, and writes the values
+ * into the caller's buffer once back on the calling thread.
+ */
+class ReadMSRsWorker : public Nan::AsyncWorker {
+public:
+	ReadMSRsWorker(Nan::Callback* callback, Local<Uint32Array> pairs, Local<Uint32Array> out, int threads)
+		: Nan::AsyncWorker(callback), threads(threads) {
+		Nan::TypedArrayContents<uint32_t> contents(pairs);
+		requests.resize(contents.length() / 2);
+		for(size_t i = 0; i < requests.size(); i++) {
+			requests[i].cpu = static_cast<int>((*contents)[2 * i]);
+			requests[i].msr = (*contents)[2 * i + 1];
+			requests[i].value = 0;
+			requests[i].error = 0;
+		}
+		SaveToPersistent("out", out);
+	}
+
+	void Execute() {
+		const char* error;
+		msr_cpu_set_t* set = sharedMSRSet(&error);
+		if(!set) {
+			return SetErrorMessage(error);
+		}
+
+		int result = cpu_rdmsr_batch(set, requests.data(), static_cast<int>(requests.size()), threads);
+		if(result < 0 && result != ERR_INVMSR) {
+			SetErrorMessage(cpuid_error());
+		}
+	}
+
+	void HandleOKCallback() {
+		Nan::HandleScope scope;
+		Nan::TypedArrayContents<uint32_t> out(GetFromPersistent("out"));
+		Local<Array> failed = Nan::New<Array>();
+
+		for(size_t i = 0, n = 0; i < requests.size() && 2 * i + 1 < out.length(); i++) {
+			(*out)[2 * i] = static_cast<uint32_t>(requests[i].value);
+			(*out)[2 * i + 1] = static_cast<uint32_t>(requests[i].value >> 32);
+			if(requests[i].error) {
+				failed->Set(n++, Nan::New(static_cast<uint32_t>(i)));
+			}
+		}
+
+		Local<Value> argv[] = { Nan::Null(), failed };
+		callback->Call(2, argv, async_resource);
+	}
+
+private:
+	std::vector<msr_request_t> requests;
+	int threads;
+};
+
+NAN_METHOD(ReadMSRs) {
+	if(!info[0]->IsUint32Array() || !info[1]->IsUint32Array()) {
+		return Nan::ThrowTypeError("Pairs and output buffer must be Uint32Arrays");
+	}
+	if(!info[3]->IsFunction()) {
+		return Nan::ThrowTypeError("Callback must be a function");
+	}
+
+	Local<Uint32Array> pairs = info[0].As<Uint32Array>();
+	Local<Uint32Array> out = info[1].As<Uint32Array>();
+	if(pairs->Length() % 2 != 0 || out->Length() != pairs->Length()) {
+		return Nan::ThrowRangeError("Output buffer must be as long as the (cpu, msr) pair list");
+	}
+
+	int threads = info[2]->IsUint32() ? Nan::To<int32_t>(info[2]).FromJust() : 0;
+	Nan::Callback* callback = new Nan::Callback(info[3].As<Function>());
+	Nan::AsyncQueueWorker(new ReadMSRsWorker(callback, pairs, out, threads));
+}
+
+NAN_MODULE_INIT(InitMSR) {
+	Nan::Set(target, Nan::New("getMSRCPUs").ToLocalChecked(),
+		Nan::GetFunction(Nan::New<FunctionTemplate>(GetMSRCPUs)).ToLocalChecked());
+	Nan::Set(target, Nan::New("readMSR").ToLocalChecked(),
+		Nan::GetFunction(Nan::New<FunctionTemplate>(ReadMSR)).ToLocalChecked());
+	Nan::Set(target, Nan::New("readMSRs").ToLocalChecked(),
+		Nan::GetFunction(Nan::New<FunctionTemplate>(ReadMSRs)).ToLocalChecked());
+}
@@ -0,0 +1,102 @@
+#include "addon.h"
+#include <libcpuid.h>
+#include <string>
+#include <vector>
+
+using namespace v8;
+
+/*
+ * Each energySampler() has its own native sampler, which keeps the previous
+ * counter readings. It lives as long as its sample() function does, so that
+ * a detached reference to that function stays valid.
+ */
+struct EnergySampler {
+	cpu_energy_sampler_t* sampler;
+	std::vector<cpu_energy_reading_t> readings;
+	Nan::Persistent<Function> owner;
+};
+
+static void releaseEnergySampler(const Nan::WeakCallbackInfo<EnergySampler>& info) {
+	EnergySampler* energy = info.GetParameter();
+	energy->owner.Reset();
+	cpu_energy_sampler_destroy(energy->sampler);
+	delete energy;
+}
+
+static Local<Value> throttledValue(double throttled) {
+	if(throttled < 0) {
+		return Nan::Null();
+	}
+	return Nan::New<Number>(throttled);
+}
+
+NAN_METHOD(SampleEnergy) {
+	EnergySampler* energy = static_cast<EnergySampler*>(info.Data().As<External>()->Value());
+	double window;
+	int count = cpu_energy_sample(energy->sampler, energy->readings.data(), static_cast<int>(energy->readings.size()), &window);
+	if(count < 0) {
+		return Nan::ThrowError(cpuid_error());
+	}
+
+	Local<Array> readings = Nan::New<Array>();
+	for(int i = 0, n = 0; i < count; i++) {
+		const cpu_energy_reading_t& r = energy->readings[i];
+		if(!r.valid) {
+			continue;
+		}
+
+		Local<Object> reading = Nan::New<Object>();
+		reading->Set(Nan::New("package").ToLocalChecked(), Nan::New(r.package));
+		if(r.cpu >= 0) {
+			reading->Set(Nan::New("cpu").ToLocalChecked(), Nan::New(r.cpu));
+		}
+		reading->Set(Nan::New("domain").ToLocalChecked(), Nan::New(cpu_energy_domain_str(r.domain)).ToLocalChecked());
+		reading->Set(Nan::New("joules").ToLocalChecked(), Nan::New<Number>(r.joules));
+		reading->Set(Nan::New("watts").ToLocalChecked(), Nan::New<Number>(r.watts));
+		reading->Set(Nan::New("totalJoules").ToLocalChecked(), Nan::New<Number>(r.total_joules));
+		reading->Set(Nan::New("throttled").ToLocalChecked(), throttledValue(r.throttled));
+		readings->Set(n++, reading);
+	}
+
+	Local<Object> result = Nan::New<Object>();
+	result->Set(Nan::New("window").ToLocalChecked(), Nan::New<Number>(window));
+	result->Set(Nan::New("readings").ToLocalChecked(), readings);
+	info.GetReturnValue().Set(result);
+}
+
+// An explicit sysfs root (e.g. a test fixture) means powercap only
+NAN_METHOD(CreateEnergySampler) {
+	msr_cpu_set_t* set = NULL;
+	std::string root;
+
+	if(info[0]->IsString()) {
+		root = *Nan::Utf8String(info[0]);
+	}
+	else {
+		const char* error;
+		set = sharedMSRSet(&error);
+	}
+
+	cpu_energy_sampler_t* sampler = cpu_energy_sampler_create(set, root.empty() ? NULL : root.c_str());
+	if(!sampler) {
+		return Nan::ThrowError(cpuid_error());
+	}
+
+	EnergySampler* energy = new EnergySampler();
+	energy->sampler = sampler;
+	energy->readings.resize(cpu_energy_sampler_count(sampler));
+
+	Local<Function> sample = Nan::GetFunction(Nan::New<FunctionTemplate>(SampleEnergy, Nan::New<External>(energy))).ToLocalChecked();
+	energy->owner.Reset(sample);
+	energy->owner.SetWeak(energy, releaseEnergySampler, Nan::WeakCallbackType::kParameter);
+
+	Local<Object> data = Nan::New<Object>();
+	data->Set(Nan::New("source").ToLocalChecked(), Nan::New(cpu_energy_source_str(cpu_energy_sampler_source(sampler))).ToLocalChecked());
+	data->Set(Nan::New("sample").ToLocalChecked(), sample);
+	info.GetReturnValue().Set(data);
+}
+
+NAN_MODULE_INIT(InitPower) {
+	Nan::Set(target, Nan::New("createEnergySampler").ToLocalChecked(),
+		Nan::GetFunction(Nan::New<FunctionTemplate>(CreateEnergySampler)).ToLocalChecked());
+}
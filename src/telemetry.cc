@@ -0,0 +1,262 @@
+#include "addon.h"
+#include <libcpuid.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <vector>
+
+using namespace v8;
+
+/*
+ * One sampler thread per process writes the live state of every CPU into a
+ * block of memory that each isolate (the main thread and every worker) sees
+ * as the same SharedArrayBuffer, so reading it never calls into the addon.
+ *
+ * The block starts with a 32 byte header of Int32 words, so that readers can
+ * use Atomics on it, followed by one row of Float64 values per CPU, indexed
+ * by the OS number of the CPU. The rows are guarded by a seqlock: the writer
+ * makes seq odd before it writes them and even again after, and a reader
+ * retries until it sees the same even seq before and after its copy.
+ */
+enum TelemetryField {
+	TELEMETRY_MHZ = 0,
+	TELEMETRY_TEMPERATURE,
+	TELEMETRY_THROTTLING,
+	TELEMETRY_UTILIZATION,
+	TELEMETRY_STRIDE
+};
+
+struct TelemetryHeader {
+	std::atomic<int32_t> seq;
+	std::atomic<int32_t> generation;
+	int32_t cpus;
+	int32_t stride;
+	int32_t interval;
+	int32_t reserved;
+	double sampledAt;
+};
+
+static_assert(sizeof(TelemetryHeader) == 32, "The JS side expects a 32 byte header");
+
+struct Telemetry {
+	TelemetryHeader* header;
+	double* values;
+	size_t size;
+	int cpus;
+	uint64_t intervalNs;
+
+	cpu_freq_sampler_t* freq;
+	cpu_times_reader_t* times;
+	std::vector<double> mhz;
+	std::vector<cpu_times_t> current;
+	std::vector<cpu_times_t> previous;
+	std::vector<cpu_thermal_info_t> thermal;
+	std::vector<long> throttleCounts;
+	std::vector<double> rows;
+
+	uv_thread_t thread;
+	uv_mutex_t lock;
+	uv_cond_t wake;
+};
+
+static uv_once_t telemetryOnce = UV_ONCE_INIT;
+static uv_mutex_t telemetryLock;
+static Telemetry* telemetry = NULL;
+
+static void initTelemetryLock() {
+	uv_mutex_init(&telemetryLock);
+}
+
+static int throttlingValue(Telemetry* t, const cpu_thermal_info_t& info) {
+	if(info.core.throttling >= 0) {
+		return info.core.throttling;
+	}
+	if(info.package.throttling >= 0) {
+		return info.package.throttling;
+	}
+	// The sysfs only counts events; a new one since the last sample counts
+	long count = info.core.throttle_count;
+	long last = t->throttleCounts[info.cpu];
+	t->throttleCounts[info.cpu] = count;
+	if(count < 0 || last < 0) {
+		return -1;
+	}
+	return count > last ? 1 : 0;
+}
+
+static void sampleTelemetry(Telemetry* t) {
+	std::fill(t->rows.begin(), t->rows.end(), -1.0);
+
+	if(t->freq) {
+		int n = cpu_freq_sample(t->freq, t->mhz.data(), static_cast<int>(t->mhz.size()));
+		for(int i = 0; i < n; i++) {
+			int cpu = cpu_freq_sampler_cpu(t->freq, i);
+			if(cpu < t->cpus) {
+				t->rows[cpu * TELEMETRY_STRIDE + TELEMETRY_MHZ] = t->mhz[i];
+			}
+		}
+	}
+
+	if(t->times) {
+		int n = cpu_times_read(t->times, t->current.data(), static_cast<int>(t->current.size()));
+		for(int i = 0; i < n; i++) {
+			int cpu = t->current[i].cpu;
+			if(cpu < 0 || cpu >= t->cpus) {
+				continue;
+			}
+			t->rows[cpu * TELEMETRY_STRIDE + TELEMETRY_UTILIZATION] = cpu_times_utilization(&t->previous[cpu], &t->current[i]);
+			t->previous[cpu] = t->current[i];
+		}
+	}
+
+	const char* msrError;
+	int n = cpu_thermal_read_all(sharedMSRSet(&msrError), NULL, t->thermal.data(), t->cpus);
+	for(int i = 0; i < n; i++) {
+		const cpu_thermal_info_t& info = t->thermal[i];
+		if(info.cpu < 0 || info.cpu >= t->cpus) {
+			continue;
+		}
+		int temperature = info.core.temperature != CPU_INVALID_VALUE ? info.core.temperature : info.package.temperature;
+		double* row = &t->rows[info.cpu * TELEMETRY_STRIDE];
+		row[TELEMETRY_TEMPERATURE] = temperature != CPU_INVALID_VALUE ? temperature : -1;
+		row[TELEMETRY_THROTTLING] = throttlingValue(t, info);
+	}
+}
+
+static void publishTelemetry(Telemetry* t) {
+	TelemetryHeader* header = t->header;
+	int32_t seq = header->seq.load(std::memory_order_relaxed);
+
+	header->seq.store(seq + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	memcpy(t->values, t->rows.data(), t->rows.size() * sizeof(double));
+	header->sampledAt = static_cast<double>(std::chrono::duration_cast<std::chrono::milliseconds>(
+		std::chrono::system_clock::now().time_since_epoch()).count());
+	header->generation.fetch_add(1, std::memory_order_relaxed);
+	header->seq.store(seq + 2, std::memory_order_release);
+}
+
+static void runTelemetry(void* arg) {
+	Telemetry* t = static_cast<Telemetry*>(arg);
+
+	uv_mutex_lock(&t->lock);
+	for(;;) {
+		uv_mutex_unlock(&t->lock);
+		sampleTelemetry(t);
+		publishTelemetry(t);
+		uv_mutex_lock(&t->lock);
+		uv_cond_timedwait(&t->wake, &t->lock, t->intervalNs);
+	}
+}
+
+int countCPUs(cpu_freq_sampler_t* freq, cpu_times_reader_t* times) {
+	int cpus = 0;
+	uv_cpu_info_t* infos;
+	if(uv_cpu_info(&infos, &cpus) == 0) {
+		uv_free_cpu_info(infos, cpus);
+	}
+
+	for(int i = 0; i < cpu_freq_sampler_count(freq); i++) {
+		if(cpu_freq_sampler_cpu(freq, i) >= cpus) {
+			cpus = cpu_freq_sampler_cpu(freq, i) + 1;
+		}
+	}
+
+	if(times) {
+		std::vector<cpu_times_t> current(cpus > 0 ? cpus * 2 : 64);
+		int n = cpu_times_read(times, current.data(), static_cast<int>(current.size()));
+		for(int i = 0; i < n; i++) {
+			if(current[i].cpu >= cpus) {
+				cpus = current[i].cpu + 1;
+			}
+		}
+	}
+	return cpus > 0 ? cpus : 1;
+}
+
+// Starts the process-wide sampler; the first caller picks the interval
+static Telemetry* startTelemetry(uint32_t interval, const char** error) {
+	uv_once(&telemetryOnce, initTelemetryLock);
+	uv_mutex_lock(&telemetryLock);
+	if(telemetry) {
+		uv_mutex_unlock(&telemetryLock);
+		return telemetry;
+	}
+
+	Telemetry* t = new Telemetry();
+	t->freq = cpu_freq_sampler_create(NULL);
+	t->times = cpu_times_open(NULL);
+	t->cpus = countCPUs(t->freq, t->times);
+	t->intervalNs = static_cast<uint64_t>(interval > 0 ? interval : 1) * 1000000;
+	t->mhz.resize(cpu_freq_sampler_count(t->freq));
+	t->current.resize(t->cpus);
+	t->previous.resize(t->cpus);
+	for(int cpu = 0; cpu < t->cpus; cpu++) {
+		t->previous[cpu].cpu = -1;
+	}
+	t->thermal.resize(t->cpus);
+	t->throttleCounts.assign(t->cpus, -1);
+	t->rows.resize(t->cpus * TELEMETRY_STRIDE);
+
+	t->size = sizeof(TelemetryHeader) + t->rows.size() * sizeof(double);
+	void* memory = calloc(1, t->size);
+	if(!memory) {
+		*error = "Out of memory";
+		cpu_freq_sampler_destroy(t->freq);
+		cpu_times_close(t->times);
+		delete t;
+		uv_mutex_unlock(&telemetryLock);
+		return NULL;
+	}
+	t->header = new(memory) TelemetryHeader();
+	t->header->cpus = t->cpus;
+	t->header->stride = TELEMETRY_STRIDE;
+	t->header->interval = static_cast<int32_t>(interval);
+	t->values = reinterpret_cast<double*>(t->header + 1);
+	std::fill(t->values, t->values + t->rows.size(), -1.0);
+
+	uv_mutex_init(&t->lock);
+	uv_cond_init(&t->wake);
+	if(uv_thread_create(&t->thread, runTelemetry, t) != 0) {
+		*error = "Cannot start the sampler thread";
+		uv_cond_destroy(&t->wake);
+		uv_mutex_destroy(&t->lock);
+		cpu_freq_sampler_destroy(t->freq);
+		cpu_times_close(t->times);
+		free(memory);
+		delete t;
+		uv_mutex_unlock(&telemetryLock);
+		return NULL;
+	}
+
+	telemetry = t;
+	uv_mutex_unlock(&telemetryLock);
+	return t;
+}
+
+/*
+ * The memory is never freed: the thread runs for the life of the process,
+ * and any isolate may hold a buffer over it until then.
+ */
+NAN_METHOD(GetTelemetryBuffer) {
+	if(!info[0]->IsUint32()) {
+		return Nan::ThrowTypeError("Interval must be an unsigned integer");
+	}
+
+	const char* error;
+	Telemetry* t = startTelemetry(Nan::To<uint32_t>(info[0]).FromJust(), &error);
+	if(!t) {
+		return Nan::ThrowError(error);
+	}
+
+	info.GetReturnValue().Set(SharedArrayBuffer::New(Isolate::GetCurrent(), t->header, t->size,
+		ArrayBufferCreationMode::kExternalized));
+}
+
+NAN_MODULE_INIT(InitTelemetry) {
+	Nan::Set(target, Nan::New("getTelemetryBuffer").ToLocalChecked(),
+		Nan::GetFunction(Nan::New<FunctionTemplate>(GetTelemetryBuffer)).ToLocalChecked());
+}
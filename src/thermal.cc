@@ -0,0 +1,115 @@
+#include "addon.h"
+#include <libcpuid.h>
+#include <string>
+#include <vector>
+
+using namespace v8;
+
+// Unknown values (-1, or CPU_INVALID_VALUE for temperatures) become null
+static Local<Value> thermalValue(long value) {
+	if(value < 0 || value == CPU_INVALID_VALUE) {
+		return Nan::Null();
+	}
+	return Nan::New<Number>(static_cast<double>(value));
+}
+
+static Local<Value> thermalFlag(int value) {
+	if(value < 0) {
+		return Nan::Null();
+	}
+	return Nan::New<Boolean>(value != 0);
+}
+
+static Local<Object> buildThermalStatus(const cpu_thermal_status_t& status) {
+	Local<Object> data = Nan::New<Object>();
+	data->Set(Nan::New("temperature").ToLocalChecked(), thermalValue(status.temperature));
+	data->Set(Nan::New("tjMax").ToLocalChecked(), thermalValue(status.tjmax));
+	data->Set(Nan::New("throttling").ToLocalChecked(), thermalFlag(status.throttling));
+	data->Set(Nan::New("throttleLog").ToLocalChecked(), thermalFlag(status.throttle_log));
+	data->Set(Nan::New("prochot").ToLocalChecked(), thermalFlag(status.prochot));
+	data->Set(Nan::New("prochotLog").ToLocalChecked(), thermalFlag(status.prochot_log));
+	data->Set(Nan::New("powerLimit").ToLocalChecked(), thermalFlag(status.power_limit));
+	data->Set(Nan::New("powerLimitLog").ToLocalChecked(), thermalFlag(status.power_limit_log));
+	data->Set(Nan::New("throttleCount").ToLocalChecked(), thermalValue(status.throttle_count));
+	return data;
+}
+
+/*
+ * Reads the thermal state of every CPU on the libuv thread pool: from the
+ * MSRs where the shared MSR handles could be opened, from hwmon/coretemp in
+ * the sysfs otherwise.
+ */
+class ThermalWorker : public Nan::AsyncWorker {
+public:
+	ThermalWorker(Nan::Callback* callback, const std::string& root)
+		: Nan::AsyncWorker(callback), root(root) {}
+
+	void Execute() {
+		msr_cpu_set_t* set = NULL;
+		const char* msrError = NULL;
+		int count = 0;
+
+		if(root.empty()) {
+			set = sharedMSRSet(&msrError);
+
+			uv_cpu_info_t* cpus;
+			if(uv_cpu_info(&cpus, &count) == 0) {
+				uv_free_cpu_info(cpus, count);
+			}
+			if(cpu_msr_set_size(set) > count) {
+				count = cpu_msr_set_size(set);
+			}
+		}
+		else {
+			count = FIXTURE_MAX_CPUS;
+		}
+
+		infos.resize(count > 0 ? count : 1);
+		int filled = cpu_thermal_read_all(set, root.empty() ? NULL : root.c_str(), infos.data(), count);
+		if(filled <= 0) {
+			return SetErrorMessage(msrError ? msrError : cpuid_error());
+		}
+		infos.resize(filled);
+	}
+
+	void HandleOKCallback() {
+		Nan::HandleScope scope;
+		Local<Array> result = Nan::New<Array>(static_cast<int>(infos.size()));
+
+		for(size_t i = 0; i < infos.size(); i++) {
+			Local<Object> cpu = Nan::New<Object>();
+			cpu->Set(Nan::New("cpu").ToLocalChecked(), Nan::New(infos[i].cpu));
+			cpu->Set(Nan::New("source").ToLocalChecked(), Nan::New(cpu_thermal_source_str(infos[i].source)).ToLocalChecked());
+			cpu->Set(Nan::New("core").ToLocalChecked(), buildThermalStatus(infos[i].core));
+			cpu->Set(Nan::New("package").ToLocalChecked(), buildThermalStatus(infos[i].package));
+			result->Set(static_cast<uint32_t>(i), cpu);
+		}
+
+		Local<Value> argv[] = { Nan::Null(), result };
+		callback->Call(2, argv, async_resource);
+	}
+
+private:
+	std::string root;
+	std::vector<cpu_thermal_info_t> infos;
+};
+
+// An explicit sysfs root (e.g. a test fixture) means hwmon and thermal_throttle only
+NAN_METHOD(GetThermal) {
+	if(!info[1]->IsFunction()) {
+		return Nan::ThrowTypeError("Callback must be a function");
+	}
+
+	std::string root;
+	if(info[0]->IsString()) {
+		root = *Nan::Utf8String(info[0]);
+	}
+
+	Nan::Callback* callback = new Nan::Callback(info[1].As<Function>());
+	Nan::AsyncQueueWorker(new ThermalWorker(callback, root));
+}
+
+NAN_MODULE_INIT(InitThermal) {
+	Nan::Set(target, Nan::New("getThermal").ToLocalChecked(),
+		Nan::GetFunction(Nan::New<FunctionTemplate>(GetThermal)).ToLocalChecked());
+}
@@ -0,0 +1,90 @@
+#include "addon.h"
+#include <libcpuid.h>
+
+using namespace v8;
+
+/*
+ * The TSC calibration is done once per process, by the first tscTimer()
+ * call in any thread. Reads are relative to its reference point, so that
+ * tick counts fit in a double with full precision for weeks.
+ */
+static uv_once_t calibrationLockOnce = UV_ONCE_INIT;
+static uv_mutex_t calibrationLock;
+static bool calibrated = false;
+static const char* calibrationError = NULL;
+static cpu_tsc_calibration_t calibration;
+
+static void initCalibrationLock() {
+	uv_mutex_init(&calibrationLock);
+}
+
+// Only handed out by CalibrateTSC() once the calibration has succeeded on
+// this thread, which also orders the reads of calibration.tsc_base after the
+// write
+NAN_METHOD(ReadTSC) {
+	uint64_t tsc;
+	cpu_rdtsc(&tsc);
+	info.GetReturnValue().Set(static_cast<double>(static_cast<int64_t>(tsc - calibration.tsc_base)));
+}
+
+NAN_METHOD(ReadTSCP) {
+	uint64_t tsc;
+	cpu_rdtscp(&tsc);
+	info.GetReturnValue().Set(static_cast<double>(static_cast<int64_t>(tsc - calibration.tsc_base)));
+}
+
+NAN_METHOD(CalibrateTSC) {
+	uv_once(&calibrationLockOnce, initCalibrationLock);
+	uv_mutex_lock(&calibrationLock);
+	if(!calibrated) {
+		if(cpu_tsc_calibrate(20, &calibration) < 0) {
+			calibrationError = cpuid_error();
+		}
+		calibrated = true;
+	}
+	uv_mutex_unlock(&calibrationLock);
+
+	if(calibrationError) {
+		return Nan::ThrowError(calibrationError);
+	}
+
+	Local<Object> data = Nan::New<Object>();
+	data->Set(Nan::New("frequency").ToLocalChecked(), Nan::New<Number>(calibration.hz));
+	data->Set(Nan::New("frequencyError").ToLocalChecked(), Nan::New<Number>(calibration.hz_error));
+	data->Set(Nan::New("nsPerTick").ToLocalChecked(), Nan::New<Number>(calibration.ns_per_tick));
+	data->Set(Nan::New("samples").ToLocalChecked(), Nan::New(calibration.samples));
+	data->Set(Nan::New("rdtscp").ToLocalChecked(), Nan::New<Boolean>(calibration.rdtscp != 0));
+	data->Set(Nan::New("readTSC").ToLocalChecked(),
+		Nan::GetFunction(Nan::New<FunctionTemplate>(ReadTSC)).ToLocalChecked());
+	data->Set(Nan::New("readTSCP").ToLocalChecked(),
+		Nan::GetFunction(Nan::New<FunctionTemplate>(ReadTSCP)).ToLocalChecked());
+	info.GetReturnValue().Set(data);
+}
+
+// Busy-waits on the calling thread, for at most budgetMs
+NAN_METHOD(MeasureClock) {
+	if(!info[0]->IsNumber() || !info[1]->IsNumber()) {
+		return Nan::ThrowTypeError("Tolerance and budget must be numbers");
+	}
+	double tolerance = Nan::To<double>(info[0]).FromJust();
+	int budget = Nan::To<int32_t>(info[1]).FromJust();
+
+	cpu_clock_estimate_t estimate;
+	if(cpu_clock_measure_adaptive(tolerance, budget, &estimate) < 0) {
+		return Nan::ThrowRangeError("Could not measure the clock");
+	}
+
+	Local<Object> data = Nan::New<Object>();
+	data->Set(Nan::New("frequency").ToLocalChecked(), Nan::New<Number>(estimate.mhz));
+	data->Set(Nan::New("error").ToLocalChecked(), Nan::New<Number>(estimate.error_mhz));
+	data->Set(Nan::New("windows").ToLocalChecked(), Nan::New(estimate.windows));
+	data->Set(Nan::New("elapsed").ToLocalChecked(), Nan::New(estimate.elapsed_ms));
+	info.GetReturnValue().Set(data);
+}
+
+NAN_MODULE_INIT(InitTimer) {
+	Nan::Set(target, Nan::New("calibrateTSC").ToLocalChecked(),
+		Nan::GetFunction(Nan::New<FunctionTemplate>(CalibrateTSC)).ToLocalChecked());
+	Nan::Set(target, Nan::New("measureClock").ToLocalChecked(),
+		Nan::GetFunction(Nan::New<FunctionTemplate>(MeasureClock)).ToLocalChecked());
+}
@@ -0,0 +1,93 @@
+#include "addon.h"
+#include <libcpuid.h>
+
+using namespace v8;
+
+/*
+ * Reads the turbo table on the libuv thread pool and, in measured mode, loads
+ * each group's number of cores in turn to cross-check it, which takes about
+ * 55 ms per group.
+ */
+class TurboWorker : public Nan::AsyncWorker {
+public:
+	TurboWorker(Nan::Callback* callback, bool measure)
+		: Nan::AsyncWorker(callback), measure(measure) {}
+
+	void Execute() {
+		const char* error;
+		msr_cpu_set_t* set = sharedMSRSet(&error);
+		if(!set) {
+			return SetErrorMessage(error);
+		}
+
+		msr_driver_t* handle = NULL;
+		for(int cpu = 0; cpu < cpu_msr_set_size(set) && !handle; cpu++) {
+			handle = cpu_msr_set_handle(set, cpu);
+		}
+		if(cpu_turbo_table(handle, &table) < 0) {
+			return SetErrorMessage(cpuid_error());
+		}
+
+		for(int i = 0; i < table.num_entries; i++) {
+			measured[i] = -1;
+			if(measure && cpu_turbo_measure(set, table.entries[i].active_cores, 50, &measured[i]) < 0) {
+				measured[i] = -1;
+			}
+		}
+	}
+
+	void HandleOKCallback() {
+		Nan::HandleScope scope;
+		Local<Object> data = Nan::New<Object>();
+		data->Set(Nan::New("baseMHz").ToLocalChecked(), Nan::New(table.base_mhz));
+		data->Set(Nan::New("busMHz").ToLocalChecked(), Nan::New(table.bus_mhz));
+		if(table.turbo_enabled < 0) {
+			data->Set(Nan::New("turboEnabled").ToLocalChecked(), Nan::Null());
+		}
+		else {
+			data->Set(Nan::New("turboEnabled").ToLocalChecked(), Nan::New<Boolean>(table.turbo_enabled != 0));
+		}
+
+		Local<Array> entries = Nan::New<Array>(table.num_entries);
+		for(int i = 0; i < table.num_entries; i++) {
+			Local<Object> entry = Nan::New<Object>();
+			entry->Set(Nan::New("activeCores").ToLocalChecked(), Nan::New(table.entries[i].active_cores));
+			entry->Set(Nan::New("mhz").ToLocalChecked(), Nan::New(table.entries[i].mhz));
+			if(measure) {
+				entry->Set(Nan::New("measuredMHz").ToLocalChecked(),
+					measured[i] > 0 ? Local<Value>(Nan::New<Number>(measured[i])) : Local<Value>(Nan::Null()));
+			}
+			entries->Set(i, entry);
+		}
+		data->Set(Nan::New("entries").ToLocalChecked(), entries);
+
+		Local<Array> pstates = Nan::New<Array>(table.num_pstates);
+		for(int i = 0; i < table.num_pstates; i++) {
+			pstates->Set(i, Nan::New(table.pstate_mhz[i]));
+		}
+		data->Set(Nan::New("pstates").ToLocalChecked(), pstates);
+
+		Local<Value> argv[] = { Nan::Null(), data };
+		callback->Call(2, argv, async_resource);
+	}
+
+private:
+	bool measure;
+	cpu_turbo_table_t table;
+	double measured[MAX_TURBO_ENTRIES];
+};
+
+NAN_METHOD(GetTurboTable) {
+	if(!info[1]->IsFunction()) {
+		return Nan::ThrowTypeError("Callback must be a function");
+	}
+
+	bool measure = info[0]->IsTrue();
+	Nan::Callback* callback = new Nan::Callback(info[1].As<Function>());
+	Nan::AsyncQueueWorker(new TurboWorker(callback, measure));
+}
+
+NAN_MODULE_INIT(InitTurbo) {
+	Nan::Set(target, Nan::New("getTurboTable").ToLocalChecked(),
+		Nan::GetFunction(Nan::New<FunctionTemplate>(GetTurboTable)).ToLocalChecked());
+}
@@ -0,0 +1,39 @@
+var assert = require('assert');
+var path = require('path');
+var cpuid = require('..');
+
+function fixture(name) {
+	var dir = path.join(__dirname, 'fixtures', 'cgroup', name);
+	return cpuid.effectiveCpus({ procfsRoot: path.join(dir, 'proc'), cgroupRoot: path.join(dir, 'cgroup') });
+}
+
+// v2: the leaf's cpuset, and its parent's cpu.max, which is tighter than its own
+var v2 = fixture('v2');
+assert.deepEqual(v2.cpus, [0, 1, 2, 3, 4, 5]);
+assert.equal(v2.quota, 2.5);
+assert.equal(v2.quotaMicros, 250000);
+assert.equal(v2.periodMicros, 100000);
+assert.equal(v2.parallelism, 3);
+assert.equal(v2.cgroupVersion, 2);
+
+// v1: cpuset and cpu,cpuacct hierarchies, the quota on the parent
+var v1 = fixture('v1');
+assert.deepEqual(v1.cpus, [2, 3, 4, 5, 9]);
+assert.equal(v1.quota, 1.5);
+assert.equal(v1.parallelism, 2);
+assert.equal(v1.cgroupVersion, 1);
+
+// A container's mountinfo, where the root of the v2 mount is its own cgroup
+var container = fixture('mountinfo');
+assert.deepEqual(container.cpus, [0, 1, 2, 3]);
+assert.equal(container.quota, 3);
+assert.equal(container.parallelism, 3);
+assert.equal(container.cgroupVersion, 2);
+
+// Hybrid: the v2 hierarchy has no cpu controller, so its cpu.max is not a quota
+var hybrid = fixture('hybrid');
+assert.deepEqual(hybrid.cpus, [1, 2]);
+assert.strictEqual(hybrid.quota, null);
+assert.strictEqual(hybrid.quotaMicros, null);
+assert.equal(hybrid.parallelism, 2);
+assert.equal(hybrid.cgroupVersion, 1);
@@ -0,0 +1,39 @@
+var assert = require('assert');
+var path = require('path');
+var cpuid = require('..');
+
+var sysfsRoot = path.join(__dirname, 'fixtures', 'cppc');
+
+cpuid.perfLevels({ sysfsRoot: sysfsRoot }).then(function(cpus) {
+	// cpu4 is offline, and has no acpi_cppc attributes
+	assert.deepEqual(cpus.map(function(cpu) { return cpu.cpu; }), [1, 0, 2, 3, 5]);
+	cpus.forEach(function(cpu) {
+		assert.equal(cpu.source, 'cppc');
+		assert.equal(cpu.lowest, 10);
+	});
+
+	// cpu0 and cpu2 tie, so they share a rank and the next one follows it
+	assert.deepEqual(cpus.map(function(cpu) { return cpu.rank; }), [0, 1, 1, 2, 3]);
+
+	assert.equal(cpus[0].highest, 230);
+	assert.equal(cpus[0].guaranteed, 100);
+	assert.equal(cpus[0].mostEfficient, 40);
+
+	// cpu0 has no guaranteed_perf, so nominal_perf stands in for it
+	assert.equal(cpus[1].highest, 166);
+	assert.equal(cpus[1].guaranteed, 100);
+	assert.equal(cpus[3].guaranteed, 90);
+
+	// nominal_freq (2900 MHz) is the frequency of nominal_perf (100)
+	assert.equal(cpus[0].highestMHz, 6670);
+	assert.equal(cpus[1].highestMHz, 4814);
+	assert.equal(cpus[3].highestMHz, 4814);
+
+	// Without nominal_freq or lowest_nonlinear_perf, they are unknown
+	assert.equal(cpus[4].highest, 120);
+	assert.strictEqual(cpus[4].highestMHz, null);
+	assert.strictEqual(cpus[4].mostEfficient, null);
+}).catch(function(err) {
+	console.error(err.stack);
+	process.exitCode = 1;
+});
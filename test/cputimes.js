@@ -0,0 +1,91 @@
+var assert = require('assert');
+var os = require('os');
+var cpuid = require('..');
+var tree = require('./fixtures/tree');
+
+// The reader rereads the /proc/stat it opened, so the tree is written to a
+// temporary directory and changed under it. CPU 2 is offline, and CPU 1 has
+// no cpufreq driver.
+function writeStat(lines) {
+	tree.write(root, {
+		'proc/stat': 'cpu  0 0 0 0 0 0 0 0 0 0\n' + lines.join('\n') + '\nintr 0\nctxt 0\n'
+	});
+}
+
+var root = tree.create('cputimes', {
+	'sys/devices/system/cpu/online': '0-1,3\n',
+	'sys/devices/system/cpu/cpu0/cpufreq/scaling_cur_freq': '2000000\n',
+	'sys/devices/system/cpu/cpu3/cpufreq/scaling_cur_freq': '1500000\n'
+});
+
+function read(delta) {
+	return cpuid.cpus({ procfsRoot: root + '/proc', sysfsRoot: root + '/sys', delta: delta });
+}
+
+function values(array) {
+	return Array.prototype.slice.call(array);
+}
+
+try {
+	//        user nice system idle iowait irq softirq steal
+	writeStat([
+		'cpu0 100 2 30 400 5 6 7 8 0 0',
+		'cpu1 200 0 10 600 0 0 0 0 0 0',
+		'cpu3 300 0 0 900 0 0 0 0 0 0'
+	]);
+	var cpus = read();
+
+	// The columns cover every CPU of the host as well
+	var count = Math.max(os.cpus().length, 4);
+	assert.equal(cpus.count, count);
+	['user', 'nice', 'sys', 'idle', 'irq', 'steal', 'iowait', 'softirq', 'speed', 'utilization'].forEach(function(field) {
+		assert.ok(cpus[field] instanceof Float64Array, field);
+		assert.equal(cpus[field].length, count, field);
+	});
+
+	// Times are in milliseconds, whatever the tick rate
+	var tick = cpus.user[0] / 100;
+	assert.ok(tick > 0);
+	function near(actual, ticks, field) {
+		assert.ok(Math.abs(actual - ticks * tick) < 1e-6, field + ': ' + actual);
+	}
+	near(cpus.nice[0], 2, 'nice');
+	near(cpus.sys[0], 30, 'sys');
+	near(cpus.idle[0], 400, 'idle');
+	near(cpus.iowait[0], 5, 'iowait');
+	near(cpus.irq[0], 6, 'irq');
+	near(cpus.softirq[0], 7, 'softirq');
+	near(cpus.steal[0], 8, 'steal');
+	near(cpus.user[3], 300, 'user');
+
+	// An offline CPU has no times and no speed; a CPU without cpufreq has
+	// the nominal speed
+	assert.equal(cpus.user[2], -1);
+	assert.equal(cpus.idle[2], -1);
+	assert.equal(cpus.speed[2], -1);
+	assert.equal(cpus.speed[0], 2000);
+	assert.equal(cpus.speed[3], 1500);
+	var nominal = cpuid().clockSpeed;
+	assert.equal(cpus.speed[1], nominal > 0 ? nominal : -1);
+
+	// Without delta, no utilization is reported
+	assert.ok(values(cpus.utilization).every(function(u) { return u === -1; }));
+
+	// CPU 0 was busy half the time and CPU 1 three quarters; the idle
+	// counter of CPU 3 started over, as when a CPU goes offline and back
+	writeStat([
+		'cpu0 150 2 30 450 5 6 7 8 0 0',
+		'cpu1 200 0 40 610 0 0 0 0 0 0',
+		'cpu3 310 0 0 10 0 0 0 0 0 0'
+	]);
+	var utilization = values(read(true).utilization);
+	assert.deepEqual(utilization.slice(0, 4), [0.5, 0.75, -1, -1]);
+	assert.ok(utilization.slice(4).every(function(u) { return u === -1; }));
+
+	// The reader is kept per root, so the columns are the same arrays
+	assert.strictEqual(read().user, cpus.user);
+	near(cpus.user[0], 150, 'user');
+}
+finally {
+	tree.remove(root);
+}
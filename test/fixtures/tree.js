@@ -0,0 +1,43 @@
+// Fixture trees that a test changes between readings, written to a
+// temporary directory
+var fs = require('fs');
+var os = require('os');
+var path = require('path');
+
+function makeDirs(dir) {
+	if (!fs.existsSync(dir)) {
+		makeDirs(path.dirname(dir));
+		fs.mkdirSync(dir);
+	}
+}
+
+// files maps paths relative to root to their contents
+function write(root, files) {
+	Object.keys(files).forEach(function(file) {
+		var target = path.join(root, file);
+		makeDirs(path.dirname(target));
+		fs.writeFileSync(target, files[file]);
+	});
+}
+
+function remove(dir) {
+	fs.readdirSync(dir).forEach(function(entry) {
+		var file = path.join(dir, entry);
+		if (fs.statSync(file).isDirectory()) {
+			remove(file);
+		}
+		else {
+			fs.unlinkSync(file);
+		}
+	});
+	fs.rmdirSync(dir);
+}
+
+module.exports.create = function(name, files) {
+	var root = fs.mkdtempSync(path.join(os.tmpdir(), 'cpuid-' + name + '-'));
+	write(root, files || {});
+	return root;
+}
+
+module.exports.write = write;
+module.exports.remove = remove;
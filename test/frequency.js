@@ -0,0 +1,72 @@
+var assert = require('assert');
+var cpuid = require('..');
+var tree = require('./fixtures/tree');
+
+// The sampler rereads the files it opened, so the tree is written to a
+// temporary directory and changed under it. CPU 1 is offline, and CPU 3 has
+// no cpufreq driver.
+function writeFrequencies(khz) {
+	var files = {};
+	Object.keys(khz).forEach(function(cpu) {
+		files['devices/system/cpu/cpu' + cpu + '/cpufreq/scaling_cur_freq'] = khz[cpu] + '\n';
+	});
+	tree.write(sysfsRoot, files);
+}
+
+var sysfsRoot = tree.create('cpufreq', {
+	'devices/system/cpu/online': '0,2-4\n',
+	'devices/system/cpu/cpu1/cpufreq/scaling_cur_freq': '1000000\n'
+});
+writeFrequencies({ 0: 3400100, 2: 800000, 4: 0 });
+
+var freq = cpuid.frequencySampler({ interval: 10, sysfsRoot: sysfsRoot });
+var finished = false;
+
+try {
+	assert.deepEqual(Array.prototype.slice.call(freq.cpus), [0, 2, 4]);
+	// The first sample is taken before the sampler returns; an unreadable
+	// frequency is -1
+	assert.deepEqual(Array.prototype.slice.call(freq.mhz), [3400.1, 800, -1]);
+
+	writeFrequencies({ 0: 1200000, 2: 4100300, 4: 2000000 });
+}
+catch (err) {
+	freq.stop();
+	tree.remove(sysfsRoot);
+	throw err;
+}
+
+function check(tries) {
+	try {
+		// A read can mix two samples, so wait for a whole new one
+		var mhz = Array.prototype.slice.call(freq.mhz);
+		if (mhz.join() !== '1200,4100.3,2000' && tries > 0) {
+			return setTimeout(check, 20, tries - 1);
+		}
+		assert.deepEqual(mhz, [1200, 4100.3, 2000]);
+
+		// The array keeps the last sample once stopped
+		freq.stop();
+		writeFrequencies({ 0: 900000, 2: 900000, 4: 900000 });
+		setTimeout(function() {
+			try {
+				assert.deepEqual(Array.prototype.slice.call(freq.mhz), [1200, 4100.3, 2000]);
+				finished = true;
+			}
+			finally {
+				tree.remove(sysfsRoot);
+			}
+		}, 50);
+	}
+	catch (err) {
+		freq.stop();
+		tree.remove(sysfsRoot);
+		throw err;
+	}
+}
+
+check(100);
+
+process.on('exit', function() {
+	assert.ok(finished, 'the sampler test did not finish');
+});
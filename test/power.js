@@ -0,0 +1,57 @@
+var assert = require('assert');
+var cpuid = require('..');
+var tree = require('./fixtures/tree');
+
+// Powercap zone names have colons, which not every file system allows in a
+// checkout, so the tree is written to a temporary directory
+var RANGE = 262143328850;
+var zones = {
+	'intel-rapl:0': { name: 'package-0', energy: [RANGE - 328850, 1000000] },
+	'intel-rapl:0:0': { name: 'core', energy: [1000000, 3000000] },
+	'intel-rapl:0:1': { name: 'dram', energy: [500000, 750000] },
+	'intel-rapl:1': { name: 'package-1', energy: [5000000, 9000000] },
+	'intel-rapl:1:0': { name: 'core', energy: [2000000, 2500000] },
+	'intel-rapl:2': { name: 'psys', energy: [10000000, 20000000] }
+};
+
+function writeZones(sample) {
+	var files = {};
+	Object.keys(zones).forEach(function(zone) {
+		var dir = 'class/powercap/' + zone + '/';
+		files[dir + 'name'] = zones[zone].name + '\n';
+		files[dir + 'max_energy_range_uj'] = RANGE + '\n';
+		files[dir + 'energy_uj'] = zones[zone].energy[sample] + '\n';
+	});
+	tree.write(sysfsRoot, files);
+}
+
+var sysfsRoot = tree.create('powercap');
+
+try {
+	writeZones(0);
+	var energy = cpuid.energySampler({ sysfsRoot: sysfsRoot });
+	assert.equal(energy.source, 'powercap');
+	assert.deepEqual(energy.sample().readings.map(function(r) { return r.joules; }), [0, 0, 0, 0, 0, 0]);
+
+	writeZones(1);
+	var readings = energy.sample().readings;
+
+	// Subzones belong to the package of their parent zone; psys to none
+	assert.deepEqual(readings.map(function(r) { return r.package + ':' + r.domain; }),
+		['0:package', '0:core', '0:dram', '1:package', '1:core', '-1:psys']);
+
+	// package-0 wrapped around max_energy_range_uj (the counter's last value)
+	assert.ok(Math.abs(readings[0].joules - 1.328851) < 1e-9, readings[0].joules);
+	assert.ok(Math.abs(readings[1].joules - 2) < 1e-9);
+	assert.ok(Math.abs(readings[2].joules - 0.25) < 1e-9);
+	assert.ok(Math.abs(readings[3].joules - 4) < 1e-9);
+	assert.ok(Math.abs(readings[4].joules - 0.5) < 1e-9);
+	assert.ok(Math.abs(readings[5].joules - 10) < 1e-9);
+	readings.forEach(function(r) {
+		assert.equal(r.totalJoules, r.joules);
+		assert.strictEqual(r.throttled, null);
+	});
+}
+finally {
+	tree.remove(sysfsRoot);
+}
@@ -0,0 +1,98 @@
+var assert = require('assert');
+var path = require('path');
+var cpuid = require('..');
+var tree = require('./fixtures/tree');
+
+// cgroup v1: cpu.stat counts throttled_time in nanoseconds, and the PSI
+// counters are system-wide
+var v1 = tree.create('pressure-v1', {
+	'proc/self/cgroup': '4:cpu,cpuacct:/docker/abc\n',
+	'proc/pressure/cpu': 'some avg10=1.50 avg60=0.80 avg300=0.20 total=123456\n',
+	'cgroup/cpu,cpuacct/docker/abc/cpu.stat': 'nr_periods 100\nnr_throttled 5\nthrottled_time 2000000000\n'
+});
+
+// cgroup v2: cpu.stat and cpu.pressure of the cgroup itself
+function v2Stat(periods, throttled, usage, throttledUsec) {
+	return 'usage_usec ' + usage + '\nuser_usec 0\nsystem_usec 0\n' +
+		'nr_periods ' + periods + '\nnr_throttled ' + throttled + '\nthrottled_usec ' + throttledUsec + '\n';
+}
+var v2 = tree.create('pressure-v2', {
+	'proc/self/cgroup': '0::/app\n',
+	'cgroup/cgroup.controllers': 'cpu\n',
+	'cgroup/app/cpu.stat': v2Stat(200, 10, 5000000, 300000),
+	'cgroup/app/cpu.pressure': 'some avg10=2.00 avg60=1.00 avg300=0.50 total=400000\n' +
+		'full avg10=1.00 avg60=0.50 avg300=0.25 total=200000\n'
+});
+
+function monitor(root) {
+	return cpuid.cpuPressure({ interval: 20, procfsRoot: path.join(root, 'proc'), cgroupRoot: path.join(root, 'cgroup') });
+}
+
+function done(err) {
+	tree.remove(v1);
+	tree.remove(v2);
+	if (err) {
+		console.error(err.stack);
+		process.exitCode = 1;
+	}
+}
+
+var first = monitor(v1);
+setTimeout(function() {
+	try {
+		var stats = first.stats();
+		first.stop();
+		assert.strictEqual(stats.throttling, false);
+		assert.strictEqual(stats.counters.usageMicros, null);
+		assert.equal(stats.counters.periods, 100);
+		assert.equal(stats.counters.throttledPeriods, 5);
+		assert.equal(stats.counters.throttledMicros, 2000000);
+		assert.equal(stats.counters.someAvg10, 1.5);
+		assert.equal(stats.counters.someAvg300, 0.2);
+		assert.strictEqual(stats.counters.fullAvg10, null);
+		// Nothing grew between the readings
+		assert.equal(stats.last10s.throttledPeriods, 0);
+		assert.equal(stats.last10s.some, 0);
+	}
+	catch (err) {
+		return done(err);
+	}
+
+	var second = monitor(v2);
+	var events = [];
+	second.on('throttled', function(stats) {
+		events.push('throttled');
+		try {
+			assert.strictEqual(stats.throttling, true);
+			assert.equal(stats.counters.usageMicros, 5800000);
+			assert.equal(stats.counters.fullAvg10, 1);
+			// 10 of the 20 periods since the first reading were throttled
+			assert.equal(stats.last10s.throttledPeriods, 0.5);
+			assert.ok(stats.last10s.usage > 0);
+			assert.ok(stats.last10s.throttled > 0);
+			assert.ok(stats.last60s.seconds >= stats.last10s.seconds);
+		}
+		catch (err) {
+			second.stop();
+			return done(err);
+		}
+		// Stopping from a listener drops the callback while events may still be queued
+		second.stop();
+	});
+	second.on('recovered', function() {
+		events.push('recovered');
+	});
+
+	setTimeout(function() {
+		tree.write(v2, { 'cgroup/app/cpu.stat': v2Stat(220, 20, 5800000, 450000) });
+	}, 60);
+	setTimeout(function() {
+		try {
+			assert.deepEqual(events, ['throttled']);
+			done();
+		}
+		catch (err) {
+			done(err);
+		}
+	}, 300);
+}, 60);
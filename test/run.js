@@ -0,0 +1,19 @@
+// Runs every test in this directory, each in its own process, against the
+// fixture trees under test/fixtures
+var fs = require('fs');
+var path = require('path');
+var spawnSync = require('child_process').spawnSync;
+
+var failed = 0;
+fs.readdirSync(__dirname).sort().forEach(function(file) {
+	if (!/\.js$/.test(file) || file === 'run.js') {
+		return;
+	}
+	var result = spawnSync(process.execPath, [path.join(__dirname, file)], { stdio: 'inherit' });
+	console.log((result.status === 0 ? 'ok ' : 'FAIL ') + file);
+	if (result.status !== 0) {
+		failed++;
+	}
+});
+
+process.exit(failed ? 1 : 0);
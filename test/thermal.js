@@ -0,0 +1,38 @@
+var assert = require('assert');
+var path = require('path');
+var cpuid = require('..');
+
+var sysfsRoot = path.join(__dirname, 'fixtures', 'thermal');
+
+cpuid.thermal({ sysfsRoot: sysfsRoot }).then(function(cpus) {
+	// cpu3 is offline
+	assert.deepEqual(cpus.map(function(cpu) { return cpu.cpu; }), [0, 1, 2]);
+	cpus.forEach(function(cpu) {
+		assert.equal(cpu.source, 'sysfs');
+		assert.strictEqual(cpu.core.throttling, null);
+		assert.strictEqual(cpu.core.prochot, null);
+	});
+
+	// Package 0 lists its cores before its "Package id 0" label
+	assert.equal(cpus[0].core.temperature, 61);
+	assert.equal(cpus[0].core.tjMax, 100);
+	assert.equal(cpus[0].package.temperature, 66);
+	assert.equal(cpus[1].core.temperature, 63);
+	assert.equal(cpus[1].package.temperature, 66);
+
+	// Core 0 of package 1 is not core 0 of package 0
+	assert.equal(cpus[2].core.temperature, 49);
+	assert.equal(cpus[2].core.tjMax, 95);
+	assert.equal(cpus[2].package.temperature, 52);
+
+	// thermal_throttle counters stand in for the log bits
+	assert.strictEqual(cpus[0].core.throttleCount, 0);
+	assert.strictEqual(cpus[0].core.throttleLog, false);
+	assert.strictEqual(cpus[0].package.throttleCount, 3);
+	assert.strictEqual(cpus[0].package.throttleLog, true);
+	assert.strictEqual(cpus[1].core.throttleCount, null);
+	assert.strictEqual(cpus[2].core.throttleCount, 12);
+}).catch(function(err) {
+	console.error(err.stack);
+	process.exitCode = 1;
+});